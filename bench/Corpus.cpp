@@ -0,0 +1,149 @@
+#include "Corpus.hpp"
+
+#include <ImageMagick-7/Magick++.h>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSize>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Corpus
+{
+
+namespace
+{
+
+struct Format
+{
+    const char *name;      // file name prefix and ImageMagick coder
+    const char *extension;
+    int depth;
+    bool alpha;
+    bool animated;
+};
+
+constexpr Format FORMATS[] = {
+    {"jpeg", "jpg", 8, false, false},  {"png", "png", 8, true, false},   {"png", "png", 16, true, false},
+    {"webp", "webp", 8, true, false},  {"avif", "avif", 8, true, false}, {"gif", "gif", 8, false, true},
+    {"tiff", "tiff", 8, true, false},  {"tiff", "tiff", 16, true, false},
+};
+
+const QSize SIZES[] = {{640, 480}, {2560, 1440}, {6000, 4000}};
+
+// Animations stay small, like the GIFs people actually open
+constexpr int ANIMATION_FRAMES   = 8;
+constexpr int ANIMATION_MAX_SIDE = 2560;
+
+inline quint32
+xorshift(quint32 &state) noexcept
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Smooth gradients with a checker pattern and some noise, so that encoders
+// have both flat and detailed areas to work on
+Magick::Image
+makeImage(const QSize &size, int frame, bool alpha, quint32 seed)
+{
+    const int w = size.width();
+    const int h = size.height();
+    std::vector<quint16> pixels(size_t(w) * h * 4);
+    quint32 state = seed ^ (quint32(frame + 1) * 0x9e3779b9u);
+    if (!state)
+        state = 1;
+
+    const double cx = w / 2.0, cy = h / 2.0;
+    const double rmax = std::sqrt(cx * cx + cy * cy);
+
+    quint16 *p = pixels.data();
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x, p += 4)
+        {
+            const int noise   = int(xorshift(state) & 0x0fff) - 0x0800;
+            const bool check  = (((x + frame * 32) >> 6) ^ (y >> 6)) & 1;
+            const double dist = std::sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy)) / rmax;
+
+            p[0] = quint16(std::clamp(int(65535.0 * x / w) + noise, 0, 65535));
+            p[1] = quint16(std::clamp(int(65535.0 * y / h) + noise, 0, 65535));
+            p[2] = quint16(check ? 0xc000 : 0x3000);
+            p[3] = alpha ? quint16(65535.0 * (1.0 - 0.8 * dist)) : 65535;
+        }
+    }
+
+    Magick::Image image(w, h, "RGBA", Magick::ShortPixel, pixels.data());
+    image.alpha(alpha);
+    return image;
+}
+
+} // namespace
+
+QStringList
+generate(const QString &dir, quint32 seed) noexcept
+{
+    QStringList files;
+    if (!QDir().mkpath(dir))
+    {
+        qWarning() << "Cannot create corpus directory" << dir;
+        return files;
+    }
+
+    for (const Format &format : FORMATS)
+    {
+        for (const QSize &size : SIZES)
+        {
+            if (format.animated && std::max(size.width(), size.height()) > ANIMATION_MAX_SIDE)
+                continue;
+
+            const QString path = QDir(dir).filePath(QString("%1-%2bit-%3x%4.%5")
+                                                        .arg(format.name)
+                                                        .arg(format.depth)
+                                                        .arg(size.width())
+                                                        .arg(size.height())
+                                                        .arg(format.extension));
+
+            try
+            {
+                std::vector<Magick::Image> frames;
+                const int count = format.animated ? ANIMATION_FRAMES : 1;
+                for (int i = 0; i < count; ++i)
+                {
+                    Magick::Image image = makeImage(size, i, format.alpha, seed);
+                    image.magick(format.name);
+                    image.depth(format.depth);
+                    image.quality(90);
+                    image.animationDelay(10);
+                    frames.push_back(std::move(image));
+                }
+
+                Magick::writeImages(frames.begin(), frames.end(), path.toStdString());
+                files << path;
+                qInfo().noquote() << "Wrote" << path;
+            }
+            catch (const Magick::Exception &e)
+            {
+                qWarning().noquote() << "Skipping" << path << ":" << e.what();
+            }
+        }
+    }
+
+    return files;
+}
+
+QString
+formatKey(const QString &filepath) noexcept
+{
+    static const QRegularExpression generated("^([a-z0-9]+-[0-9]+bit)-[0-9]+x[0-9]+$");
+
+    const QFileInfo info(filepath);
+    const QRegularExpressionMatch match = generated.match(info.completeBaseName());
+    return match.hasMatch() ? match.captured(1) : info.suffix().toLower();
+}
+
+} // namespace Corpus
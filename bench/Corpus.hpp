@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Reproducible benchmark images. Pixels come from a seeded generator rather
+// than ImageMagick's random patterns so that the same seed gives byte-identical
+// files across machines and ImageMagick versions (for a given encoder).
+namespace Corpus
+{
+
+// Write the corpus into `dir`, one file per format, bit depth and size, named
+// `<format>-<depth>bit-<width>x<height>.<ext>`. Formats without an encoder in
+// this ImageMagick build are skipped with a warning. Returns the written files.
+QStringList generate(const QString &dir, quint32 seed) noexcept;
+
+// Group key of a corpus file: `<format>-<depth>bit` for generated files, the
+// lowercase suffix for anything else
+QString formatKey(const QString &filepath) noexcept;
+
+} // namespace Corpus
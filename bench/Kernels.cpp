@@ -0,0 +1,254 @@
+#include "ImageDecoder.hpp"
+#include "PixelOps.hpp"
+
+#include <QGuiApplication>
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <benchmark/benchmark.h>
+#include <vector>
+
+#ifdef HAS_LIBAVIF
+#include <avif/avif.h>
+#endif
+
+// Micro-benchmarks of the hot pixel loops. Every benchmark takes the image
+// width (height is 2/3 of it) and a thread count, 0 meaning all cores, e.g.
+//   iv-kernels --benchmark_filter=Orient
+// The thread count applies to the global thread pool and ImageMagick.
+
+namespace
+{
+
+int
+applyThreads(const benchmark::State &state) noexcept
+{
+    const int threads = state.range(1) ? int(state.range(1)) : QThread::idealThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    Magick::ResourceLimits::thread(threads);
+    return threads;
+}
+
+QSize
+imageSize(const benchmark::State &state) noexcept
+{
+    const int width = int(state.range(0));
+    return QSize(width, width * 2 / 3);
+}
+
+// Deterministic gradient with a little structure, never uniform so that no
+// kernel can take an all-opaque or all-equal shortcut by accident
+QImage
+makeImage(const QSize &size, QImage::Format format)
+{
+    QImage img(size, QImage::Format_ARGB32);
+    for (int y = 0; y < img.height(); ++y)
+    {
+        auto *line = reinterpret_cast<QRgb *>(img.scanLine(y));
+        for (int x = 0; x < img.width(); ++x)
+        {
+            const int alpha = 128 + ((x ^ y) & 127);
+            line[x]         = qRgba(x & 255, y & 255, (x + y) & 255, alpha);
+        }
+    }
+    return format == QImage::Format_ARGB32 ? img : img.convertToFormat(format);
+}
+
+void
+setCounters(benchmark::State &state, const QSize &size, int threads) noexcept
+{
+    const qint64 pixels = qint64(size.width()) * size.height();
+    state.SetItemsProcessed(state.iterations() * pixels);
+    state.SetBytesProcessed(state.iterations() * pixels * 4);
+    state.counters["threads"] = threads;
+}
+
+void
+sizesAndThreads(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"width", "threads"})
+        ->ArgsProduct({{640, 2560, 6000}, {1, 4, 0}})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+}
+
+void
+BM_MagickToQImage(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, QImage::Format_ARGB32);
+    Magick::Image image(size.width(), size.height(), "BGRA", Magick::CharPixel, src.constBits());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ImageDecoder::magickImageToQImage(image));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_MagickToQImage)->Apply(sizesAndThreads);
+
+#ifdef HAS_LIBAVIF
+void
+BM_AvifYUVToRGB(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+
+    avifImage *yuv = avifImageCreate(size.width(), size.height(), 8, AVIF_PIXEL_FORMAT_YUV420);
+    avifImageAllocatePlanes(yuv, AVIF_PLANES_ALL);
+    for (int plane = AVIF_CHAN_Y; plane <= AVIF_CHAN_V; ++plane)
+    {
+        const uint32_t rows = plane == AVIF_CHAN_Y ? yuv->height : (yuv->height + 1) / 2;
+        for (uint32_t y = 0; y < rows; ++y)
+        {
+            uint8_t *line = avifImagePlane(yuv, plane) + size_t(y) * avifImagePlaneRowBytes(yuv, plane);
+            for (uint32_t x = 0; x < avifImagePlaneRowBytes(yuv, plane); ++x)
+                line[x] = uint8_t(x + y * plane);
+        }
+    }
+
+    // Same output setup as ImageDecoder::avifToQImage
+    QImage img(size, QImage::Format_ARGB32_Premultiplied);
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, yuv);
+    rgb.format             = AVIF_RGB_FORMAT_BGRA;
+    rgb.depth              = 8;
+    rgb.alphaPremultiplied = AVIF_TRUE;
+    rgb.pixels             = img.bits();
+    rgb.rowBytes           = static_cast<uint32_t>(img.bytesPerLine());
+#if AVIF_VERSION_MAJOR >= 1
+    rgb.maxThreads = threads;
+#endif
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(avifImageYUVToRGB(yuv, &rgb));
+
+    avifImageDestroy(yuv);
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_AvifYUVToRGB)->Apply(sizesAndThreads);
+#endif
+
+// Decoder output formats that PixelOps::normalize has dedicated paths for
+template <QImage::Format Format>
+void
+BM_Normalize(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, Format);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(PixelOps::normalize(src.copy()));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK_TEMPLATE(BM_Normalize, QImage::Format_ARGB32)->Apply(sizesAndThreads);
+BENCHMARK_TEMPLATE(BM_Normalize, QImage::Format_RGBA8888)->Apply(sizesAndThreads);
+BENCHMARK_TEMPLATE(BM_Normalize, QImage::Format_RGB888)->Apply(sizesAndThreads);
+
+void
+BM_HalfScale(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(PixelOps::halfScale(src));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_HalfScale)->Apply(sizesAndThreads);
+
+void
+BM_BuildMipChain(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(PixelOps::buildMipChain(src));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_BuildMipChain)->Apply(sizesAndThreads);
+
+// The high quality resample ImageView::renderVisibleRegion() runs, here to a
+// third of the source size
+void
+BM_SmoothScale(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(src.scaled(size / 3, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_SmoothScale)->Apply(sizesAndThreads);
+
+template <PixelOps::Orientation O>
+void
+BM_Orient(benchmark::State &state)
+{
+    const int threads = applyThreads(state);
+    const QSize size  = imageSize(state);
+    const QImage src  = makeImage(size, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(PixelOps::orient(src, O));
+
+    setCounters(state, size, threads);
+}
+BENCHMARK_TEMPLATE(BM_Orient, PixelOps::Orientation::Rotate90)->Apply(sizesAndThreads);
+BENCHMARK_TEMPLATE(BM_Orient, PixelOps::Orientation::Rotate180)->Apply(sizesAndThreads);
+BENCHMARK_TEMPLATE(BM_Orient, PixelOps::Orientation::FlipHorizontal)->Apply(sizesAndThreads);
+BENCHMARK_TEMPLATE(BM_Orient, PixelOps::Orientation::FlipVertical)->Apply(sizesAndThreads);
+
+// The minimap has no thumbnail of its own: it paints the full pixmap scaled
+// down with smooth filtering. This is that paint into a 200 pixel wide target.
+void
+BM_MinimapThumbnail(benchmark::State &state)
+{
+    const int threads  = applyThreads(state);
+    const QSize size   = imageSize(state);
+    const QPixmap pix  = QPixmap::fromImage(makeImage(size, QImage::Format_ARGB32_Premultiplied));
+    const QSize target = size.scaled(200, 200, Qt::KeepAspectRatio);
+    QImage thumb(target, QImage::Format_ARGB32_Premultiplied);
+
+    for (auto _ : state)
+    {
+        QPainter painter(&thumb);
+        painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+        painter.drawPixmap(thumb.rect(), pix);
+        painter.end();
+        benchmark::ClobberMemory();
+    }
+
+    setCounters(state, size, threads);
+}
+BENCHMARK(BM_MinimapThumbnail)->Apply(sizesAndThreads);
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    // QPixmap needs a platform plugin, no window is ever shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    ImageDecoder::initialize();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
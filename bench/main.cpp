@@ -0,0 +1,270 @@
+#include "Corpus.hpp"
+#include "DecoderSelector.hpp"
+#include "ImageDecoder.hpp"
+#include "argparse.hpp"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMimeDatabase>
+#include <QPixmap>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sys/resource.h>
+
+// Headless decode benchmark: runs the decode and GUI-thread upload that
+// ImageView performs for every file of a corpus and reports latency
+// percentiles, throughput and peak RSS as JSON.
+
+namespace
+{
+
+struct Sample
+{
+    qint64 decodeNs;
+    qint64 uploadNs;
+    qint64 pixels;
+    qint64 fileBytes;
+    QString backend; // DecoderSelector backend of a still image
+};
+
+// Decode like ImageView does, then upload to a pixmap on this (GUI) thread
+bool
+runOnce(const QString &path, const QString &mime, Sample &sample) noexcept
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QImage> images;
+    DecodeResult result = ImageDecoder::decode(path, mime);
+    if (result.animated)
+    {
+        QVector<int> delays;
+        images = ImageDecoder::decodeFrames(path, delays);
+    }
+    else if (result.ok())
+        images.append(result.image);
+
+    sample.decodeNs = timer.nsecsElapsed();
+    sample.backend  = result.timing.backend;
+    if (images.isEmpty())
+        return false;
+
+    timer.restart();
+    sample.pixels = 0;
+    for (const QImage &img : images)
+    {
+        const QPixmap pix = QPixmap::fromImage(img);
+        sample.pixels += qint64(pix.width()) * pix.height();
+    }
+    sample.uploadNs = timer.nsecsElapsed();
+    return true;
+}
+
+// Nearest-rank percentile of sorted `values`
+double
+percentile(const QVector<double> &values, double p) noexcept
+{
+    if (values.isEmpty())
+        return 0;
+    const qsizetype rank = qsizetype(std::ceil(p / 100.0 * values.size()));
+    return values[std::clamp<qsizetype>(rank - 1, 0, values.size() - 1)];
+}
+
+QJsonObject
+summarize(const QVector<Sample> &samples) noexcept
+{
+    QVector<double> total, decode, upload;
+    double seconds = 0, megapixels = 0, megabytes = 0;
+    for (const Sample &s : samples)
+    {
+        total.append((s.decodeNs + s.uploadNs) / 1e6);
+        decode.append(s.decodeNs / 1e6);
+        upload.append(s.uploadNs / 1e6);
+        seconds += (s.decodeNs + s.uploadNs) / 1e9;
+        megapixels += s.pixels / 1e6;
+        megabytes += s.fileBytes / (1024.0 * 1024.0);
+    }
+    std::sort(total.begin(), total.end());
+    std::sort(decode.begin(), decode.end());
+    std::sort(upload.begin(), upload.end());
+
+    auto latency = [](const QVector<double> &v)
+    {
+        return QJsonObject{
+            {"p50", percentile(v, 50)},
+            {"p95", percentile(v, 95)},
+            {"p99", percentile(v, 99)},
+        };
+    };
+
+    return QJsonObject{
+        {"samples", samples.size()},
+        {"latency_ms", latency(total)},
+        {"decode_ms", latency(decode)},
+        {"upload_ms", latency(upload)},
+        {"megapixels_per_second", seconds > 0 ? megapixels / seconds : 0},
+        {"megabytes_per_second", seconds > 0 ? megabytes / seconds : 0},
+    };
+}
+
+qint64
+peakRssKiB() noexcept
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // KiB on Linux
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+    // No window is ever shown, but QPixmap needs a platform plugin
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    ImageDecoder::initialize();
+
+    argparse::ArgumentParser program("iv-bench", IV_BENCH_VERSION);
+    program.add_argument("--generate")
+        .help("Write the synthetic corpus to DIR and exit")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("DIR");
+    program.add_argument("--seed").help("Seed of the corpus generator").default_value(1).scan<'i', int>();
+    program.add_argument("-n", "--iterations")
+        .help("Timed runs per file, after one warm-up run")
+        .default_value(5)
+        .scan<'i', int>();
+    program.add_argument("-o", "--output")
+        .help("Write the JSON report to FILE instead of stdout")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("FILE");
+    program.add_argument("--decoder")
+        .help("Decode with NAME (qt, magick, avif) where it reads the format, or \"auto\" to let iv choose by "
+              "measured speed; by default the decoder iv starts out with")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("NAME");
+    program.add_argument("corpus").help("Directory of images to decode").default_value(std::string()).metavar("DIR");
+
+    try
+    {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n" << program;
+        return 1;
+    }
+
+    const QString generateDir = QString::fromStdString(program.get<std::string>("--generate"));
+    if (!generateDir.isEmpty())
+        return Corpus::generate(generateDir, quint32(program.get<int>("--seed"))).isEmpty() ? 1 : 0;
+
+    const QString corpusDir = QString::fromStdString(program.get<std::string>("corpus"));
+    const int iterations    = std::max(1, program.get<int>("--iterations"));
+    const QString decoder   = QString::fromStdString(program.get<std::string>("--decoder"));
+    if (corpusDir.isEmpty() || !QFileInfo(corpusDir).isDir())
+    {
+        std::cerr << "No corpus directory given\n" << program;
+        return 1;
+    }
+
+    QStringList files;
+    QDirIterator it(corpusDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        files << it.next();
+    files.sort();
+
+    QMimeDatabase mimeDb;
+    QMap<QString, QVector<Sample>> byFormat;
+    QJsonArray fileReports;
+
+    for (const QString &path : files)
+    {
+        const QString mime    = mimeDb.mimeTypeForFile(path).name();
+        const qint64 fileSize = QFileInfo(path).size();
+
+        // One decoder per run, or the iterations would alternate between
+        // them while DecoderSelector measures
+        const QString backend = decoder.isEmpty() ? DecoderSelector::candidates(mime).first() : decoder;
+        DecoderSelector::instance().setOverrides({{DecoderSelector::formatOf(mime), backend}});
+
+        Sample sample{};
+        sample.fileBytes = fileSize;
+        if (!runOnce(path, mime, sample))
+        {
+            std::cerr << "Skipping undecodable " << path.toStdString() << "\n";
+            continue;
+        }
+
+        QVector<Sample> samples;
+        int failures = 0;
+        for (int i = 0; i < iterations; ++i)
+        {
+            if (runOnce(path, mime, sample))
+                samples.append(sample);
+            else
+                ++failures;
+        }
+        if (failures > 0)
+            std::cerr << "\n" << failures << " of " << iterations << " runs failed on " << path.toStdString() << "\n";
+        if (samples.isEmpty())
+            continue;
+
+        const QString key = Corpus::formatKey(path);
+        byFormat[key] += samples;
+
+        QJsonObject report = summarize(samples);
+        report["file"]     = QDir(corpusDir).relativeFilePath(path);
+        report["format"]   = key;
+        report["decoder"]  = sample.backend;
+        report["bytes"]    = fileSize;
+        report["failures"] = failures;
+        fileReports.append(report);
+        std::cerr << "." << std::flush;
+    }
+    std::cerr << "\n";
+
+    QJsonObject formats;
+    for (auto f = byFormat.cbegin(); f != byFormat.cend(); ++f)
+        formats[f.key()] = summarize(f.value());
+
+    const QJsonObject root{
+        {"version", IV_BENCH_VERSION},
+        {"iterations", iterations},
+        {"formats", formats},
+        {"files", fileReports},
+        {"peak_rss_kib", peakRssKiB()},
+    };
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    const QString output = QString::fromStdString(program.get<std::string>("--output"));
+    if (output.isEmpty())
+    {
+        std::cout << json.toStdString();
+        return 0;
+    }
+
+    QFile file(output);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::cerr << "Cannot write " << output.toStdString() << "\n";
+        return 1;
+    }
+    file.write(json);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "CommandServer.hpp"
+
+#include "SingleInstance.hpp"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+
+constexpr int CONNECT_TIMEOUT_MS = 200;
+
+// Commands may open dialogs or decode synchronously (e.g. copying a large
+// image), so replies are given a generous time
+constexpr int REPLY_TIMEOUT_MS = 30 * 1000;
+
+CommandServer::CommandServer(Handler handler, QObject *parent) noexcept
+    : QObject(parent), m_handler(std::move(handler))
+{
+}
+
+QString
+CommandServer::serverName() noexcept
+{
+    return SingleInstance::socketPath("iv-command");
+}
+
+bool
+CommandServer::listen() noexcept
+{
+    m_server = new QLocalServer(this);
+    if (!SingleInstance::listenExclusive(m_server, serverName()))
+        return false;
+
+    connect(m_server, &QLocalServer::newConnection, this, [this]()
+    {
+        while (QLocalSocket *socket = m_server->nextPendingConnection())
+        {
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readCommands(socket); });
+            readCommands(socket);
+        }
+    });
+    return true;
+}
+
+void
+CommandServer::readCommands(QLocalSocket *client) noexcept
+{
+    // A command that opens a dialog runs a nested event loop; lines arriving
+    // meanwhile are picked up by this loop, in order. The client may give up
+    // and disconnect in there, which deletes the socket.
+    QPointer<QLocalSocket> socket = client;
+    if (socket->property("iv_busy").toBool())
+        return;
+    socket->setProperty("iv_busy", true);
+
+    while (socket && socket->canReadLine())
+    {
+        const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const qsizetype space  = line.indexOf(' ');
+        const QString command  = space < 0 ? line : line.left(space);
+        const QString argument = space < 0 ? QString() : line.mid(space + 1).trimmed();
+
+        QString error;
+        QElapsedTimer timer;
+        timer.start();
+        const QJsonValue result = m_handler(command, argument, error);
+        const double ms         = timer.nsecsElapsed() / 1e6;
+        if (!socket)
+            return;
+
+        QJsonObject reply{
+            {"command", command},
+            {"ok", error.isEmpty()},
+            {"ms", ms},
+        };
+        if (!error.isEmpty())
+            reply["error"] = error;
+        else if (!result.isUndefined() && !result.isNull())
+            reply["result"] = result;
+
+        socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (!socket)
+        return;
+
+    socket->setProperty("iv_busy", false);
+    socket->flush();
+}
+
+bool
+CommandServer::send(const QStringList &commands, QStringList &replies) noexcept
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS))
+        return false;
+
+    QByteArray batch;
+    qsizetype expected = 0;
+    for (const QString &command : commands)
+    {
+        const QString line = command.trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        batch += line.toUtf8() + '\n';
+        ++expected;
+    }
+
+    socket.write(batch);
+    if (!socket.waitForBytesWritten(REPLY_TIMEOUT_MS))
+        return false;
+
+    while (replies.size() < expected)
+    {
+        if (!socket.canReadLine() && !socket.waitForReadyRead(REPLY_TIMEOUT_MS))
+            return false;
+        while (socket.canReadLine())
+            replies.append(QString::fromUtf8(socket.readLine()).trimmed());
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QJsonValue>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QStringList>
+#include <functional>
+
+// Scripted control over a per-user local socket. Clients write commands, one
+// per line (`zoom_in`, `open /path/to/file`, ...), as many as they like in one
+// go; every line is executed in order and answered with one line of JSON:
+//   {"command": "zoom_in", "ok": true, "ms": 0.08, "result": ...}
+// The timing covers the command's synchronous part, decoding of opened files
+// continues in the background.
+class CommandServer : public QObject
+{
+    Q_OBJECT
+public:
+    // Runs `command` with the rest of the line as `argument`. Sets `error` on
+    // failure; the return value goes into the reply's "result".
+    using Handler = std::function<QJsonValue(const QString &command, const QString &argument, QString &error)>;
+
+    explicit CommandServer(Handler handler, QObject *parent = nullptr) noexcept;
+
+    bool listen() noexcept;
+
+    static QString serverName() noexcept;
+
+    // Client side: send `commands` and collect one reply per command. Returns
+    // false when no instance serves commands.
+    static bool send(const QStringList &commands, QStringList &replies) noexcept;
+
+private:
+    void readCommands(QLocalSocket *socket) noexcept;
+
+    Handler m_handler;
+    QLocalServer *m_server{nullptr};
+};
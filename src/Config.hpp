@@ -43,6 +43,7 @@ struct Config
         QString statusbar_position{"bottom"};
         int statusbar_padding{5};
         bool statusbar_filepath_complete{true};
+        bool statusbar_memory{false};
     };
 
     struct Rendering
@@ -69,9 +70,20 @@ struct Config
         bool auto_fit{false};
         bool keybind_conflict_warning{true};
         bool copy_transformed_image{false};
+        bool copy_viewport_native_resolution{false};
+        int memory_budget_mb{4096};
+        int prefetch_tabs{2};
+        bool single_instance{false};
+        bool command_server{false};
+        int decode_workers{0};
+        int decode_timeout_s{30};
+        int decode_memory_limit_mb{4096};
+        int max_decoded_mb{1024};
+        int max_frames{1000};
     };
 
     QMap<QString, QString> shortcutMap;
+    QMap<QString, QString> decoderMap; // [decoders], format to backend
     UI ui{};
     Rendering rendering{};
     Behavior behavior{};
@@ -0,0 +1,164 @@
+#include "DecodeScheduler.hpp"
+
+#include <QThread>
+#include <algorithm>
+
+namespace
+{
+thread_local DecodeScheduler::Priority t_priority = DecodeScheduler::Priority::Visible;
+} // namespace
+
+DecodeScheduler &
+DecodeScheduler::instance() noexcept
+{
+    static DecodeScheduler scheduler;
+    return scheduler;
+}
+
+DecodeScheduler::DecodeScheduler() noexcept
+{
+    const int cores = std::max(1, QThread::idealThreadCount());
+
+    m_visible_pool.setMaxThreadCount(cores);
+    m_background_pool.setMaxThreadCount(cores);
+    // LowPriority is no different from normal threads under SCHED_OTHER
+    m_background_pool.setThreadPriority(QThread::IdlePriority);
+
+    m_caps[int(Priority::Visible)]     = cores;
+    m_caps[int(Priority::Prefetch)]    = std::max(1, cores / 2);
+    m_caps[int(Priority::Maintenance)] = 1;
+}
+
+void
+DecodeScheduler::setCap(Priority priority, int tasks) noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    m_caps[int(priority)] = std::max(1, tasks);
+    if (priority == Priority::Visible)
+        m_visible_pool.setMaxThreadCount(m_caps[int(priority)]);
+    dispatchLocked();
+}
+
+DecodeScheduler::Priority
+DecodeScheduler::currentPriority() noexcept
+{
+    return t_priority;
+}
+
+void
+DecodeScheduler::enqueue(Priority priority, const QString &key, const CancelToken &token,
+                         std::function<void(bool cancelled)> body) noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    m_queues[int(priority)].push_back({priority, key, token, std::move(body)});
+    dispatchLocked();
+}
+
+void
+DecodeScheduler::reprioritize(const QString &key, Priority priority) noexcept
+{
+    if (key.isEmpty())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    for (std::deque<Task> &queue : m_queues)
+    {
+        for (auto it = queue.begin(); it != queue.end();)
+        {
+            if (it->key != key || it->priority == priority)
+            {
+                ++it;
+                continue;
+            }
+            it->priority = priority;
+            m_queues[int(priority)].push_back(std::move(*it));
+            it = queue.erase(it);
+        }
+    }
+    dispatchLocked();
+}
+
+bool
+DecodeScheduler::drop(const QString &key) noexcept
+{
+    if (key.isEmpty())
+        return false;
+
+    QMutexLocker lock(&m_mutex);
+    bool dropped = false;
+    for (std::deque<Task> &queue : m_queues)
+    {
+        for (auto it = queue.begin(); it != queue.end();)
+        {
+            if (it->key != key)
+            {
+                ++it;
+                continue;
+            }
+            it->body(true);
+            it      = queue.erase(it);
+            dropped = true;
+        }
+    }
+    return dropped;
+}
+
+void
+DecodeScheduler::dispatchLocked() noexcept
+{
+    // Cancelled tasks only resolve their futures, that needs no thread
+    for (std::deque<Task> &queue : m_queues)
+    {
+        for (auto it = queue.begin(); it != queue.end();)
+        {
+            if (!it->token.cancelled())
+            {
+                ++it;
+                continue;
+            }
+            it->body(true);
+            it = queue.erase(it);
+        }
+    }
+
+    std::deque<Task> &visible = m_queues[int(Priority::Visible)];
+    while (!visible.empty())
+    {
+        start(m_visible_pool, std::move(visible.front()));
+        visible.pop_front();
+    }
+
+    int background = 0;
+    for (int i = int(Priority::Prefetch); i < CLASS_COUNT; ++i)
+        background += m_running[i];
+
+    for (int i = int(Priority::Prefetch); i < CLASS_COUNT; ++i)
+    {
+        std::deque<Task> &queue = m_queues[i];
+        while (!queue.empty() && m_running[i] < m_caps[i] && background < m_background_pool.maxThreadCount())
+        {
+            start(m_background_pool, std::move(queue.front()));
+            queue.pop_front();
+            ++background;
+        }
+    }
+}
+
+// Called with m_mutex held
+void
+DecodeScheduler::start(QThreadPool &pool, Task task) noexcept
+{
+    const int slot = int(task.priority);
+    ++m_running[slot];
+
+    pool.start([this, slot, task = std::move(task)]()
+    {
+        t_priority = task.priority;
+        task.body(task.token.cancelled());
+        t_priority = Priority::Visible;
+
+        QMutexLocker lock(&m_mutex);
+        --m_running[slot];
+        dispatchLocked();
+    });
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QFuture>
+#include <QMutex>
+#include <QPromise>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+// Shared between whoever queued a task and the task itself. Copies refer to
+// the same flag.
+class CancelToken
+{
+public:
+    CancelToken() noexcept : m_flag(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    inline void cancel() const noexcept
+    {
+        m_flag->store(true, std::memory_order_relaxed);
+    }
+
+    inline bool cancelled() const noexcept
+    {
+        return m_flag->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+// The background work of the viewer (decoding, prefetching, animation frames,
+// mip levels, resampling, clipboard encoding) in priority classes, so that
+// prefetch and housekeeping never delay the image on screen.
+//
+// Visible tasks start right away on threads of their own. The other classes
+// share a second set of threads at idle OS priority (SCHED_IDLE on Linux),
+// taken in class order and each class up to its cap; they only get a core
+// that nothing else wants, so the visible image never waits for them.
+class DecodeScheduler
+{
+public:
+    enum class Priority
+    {
+        Visible,     // the image in front of the user and anything it waits for
+        Prefetch,    // the images the user is likely to view next
+        Maintenance, // derived data that only improves what is already shown
+    };
+
+    static DecodeScheduler &instance() noexcept;
+
+    // Run `fn` in class `priority`. A task whose token is cancelled before
+    // it starts is dropped; its future then holds a default-constructed
+    // result. Queued tasks with a `key` can be moved to another class with
+    // reprioritize().
+    template <typename Fn>
+    auto run(Priority priority, Fn &&fn, const QString &key = QString(), const CancelToken &token = CancelToken())
+        -> QFuture<std::invoke_result_t<Fn>>
+    {
+        using T      = std::invoke_result_t<Fn>;
+        auto promise = std::make_shared<QPromise<T>>();
+        promise->start();
+
+        enqueue(priority, key, token, [promise, fn = std::forward<Fn>(fn)](bool cancelled) mutable
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                if (!cancelled)
+                    fn();
+            }
+            else
+                promise->addResult(cancelled ? T() : fn());
+            promise->finish();
+        });
+        return promise->future();
+    }
+
+    // Move the queued tasks with `key` to class `priority`, e.g. a prefetch
+    // of the tab that just became current. Tasks already running keep going.
+    void reprioritize(const QString &key, Priority priority) noexcept;
+
+    // Drop the queued tasks with `key` as if they had been cancelled. Tasks
+    // already running are left alone. True when any task was dropped.
+    bool drop(const QString &key) noexcept;
+
+    // At most `tasks` tasks of class `priority` at a time. Visible tasks are
+    // limited by their threads only.
+    void setCap(Priority priority, int tasks) noexcept;
+
+    // Class of the task running on the calling thread; Visible outside of
+    // scheduler tasks (GUI thread, startup workers)
+    static Priority currentPriority() noexcept;
+
+private:
+    static constexpr int CLASS_COUNT = 3;
+
+    struct Task
+    {
+        Priority priority;
+        QString key;
+        CancelToken token;
+        std::function<void(bool cancelled)> body;
+    };
+
+    DecodeScheduler() noexcept;
+
+    void enqueue(Priority priority, const QString &key, const CancelToken &token,
+                 std::function<void(bool cancelled)> body) noexcept;
+    void dispatchLocked() noexcept;
+    void start(QThreadPool &pool, Task task) noexcept;
+
+    QMutex m_mutex;
+    std::deque<Task> m_queues[CLASS_COUNT];
+    int m_running[CLASS_COUNT]{};
+    int m_caps[CLASS_COUNT]{};
+
+    QThreadPool m_visible_pool;
+    QThreadPool m_background_pool;
+};
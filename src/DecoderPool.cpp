@@ -0,0 +1,504 @@
+#include "DecoderPool.hpp"
+
+#include "DecoderSelector.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A request is one line of JSON on the worker's stdin,
+//   {"id": 7, "path": "...", "mime": "image/png", "segment": "/iv-1234-7"}
+// answered by one line on its stdout with the DecodeResult and, for a still
+// image, the geometry of the pixels it left in the shared memory segment.
+// Requests carry the DecodeLimits and the [decoders] overrides of the window
+// as well; replies the DecodeTiming, which the window records.
+
+// Workers that exit before serving anything this many times in a row mean
+// something is wrong with the executable, not with a file
+constexpr int MAX_FAILED_STARTS = 3;
+
+namespace
+{
+
+struct Mapping
+{
+    void *data;
+    size_t size;
+};
+
+void
+unmapSegment(void *info)
+{
+    Mapping *mapping = static_cast<Mapping *>(info);
+    munmap(mapping->data, mapping->size);
+    delete mapping;
+}
+
+// Worker side: copy `image` into a new shared memory segment `name`
+bool
+writeSegment(const QString &name, const QImage &image) noexcept
+{
+    const QByteArray key = name.toLocal8Bit();
+    const int fd         = shm_open(key.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+
+    const size_t size = size_t(image.sizeInBytes());
+    void *data        = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(key.constData());
+        return false;
+    }
+
+    std::memcpy(data, image.constBits(), size);
+    munmap(data, size);
+    return true;
+}
+
+} // namespace
+
+DecoderPool::DecoderPool(QObject *parent) noexcept : QObject(parent)
+{
+}
+
+DecoderPool::~DecoderPool() noexcept
+{
+    DecodeResult stopped;
+    stopped.errorTitle   = "Open File";
+    stopped.errorMessage = "Decoding was stopped because the decoder processes were shut down.";
+
+    for (Worker *worker : m_workers)
+    {
+        disconnect(worker->process, nullptr, this, nullptr);
+        worker->process->kill();
+        worker->process->waitForFinished(1000);
+        if (worker->job)
+        {
+            shm_unlink(worker->job->segment.toLocal8Bit().constData());
+            finish(*worker->job, stopped);
+        }
+        delete worker;
+    }
+
+    for (Job &job : m_queue)
+        finish(job, stopped);
+}
+
+void
+DecoderPool::configure(int workers, int timeoutMs, int memoryLimitMb) noexcept
+{
+    m_worker_count    = std::max(0, workers);
+    m_timeout_ms      = std::max(0, timeoutMs);
+    m_memory_limit_mb = std::max(0, memoryLimitMb);
+    dispatch();
+}
+
+QFuture<DecodeResult>
+DecoderPool::decode(const QString &filepath, const QString &mimeType, DecodeScheduler::Priority priority,
+                    const QString &key) noexcept
+{
+    Job job;
+    job.id       = m_next_id++;
+    job.filepath = filepath;
+    job.mimeType = mimeType;
+    job.key      = key;
+    job.priority = priority;
+    job.segment  = QString("/iv-%1-%2").arg(QCoreApplication::applicationPid()).arg(job.id);
+    job.promise  = std::make_shared<QPromise<DecodeResult>>();
+    job.promise->start();
+
+    QFuture<DecodeResult> future = job.promise->future();
+    if (m_broken || m_worker_count == 0)
+        decodeInProcess(std::move(job));
+    else
+    {
+        m_queue.append(std::move(job));
+        dispatch();
+    }
+    return future;
+}
+
+void
+DecoderPool::reprioritize(const QString &key, DecodeScheduler::Priority priority) noexcept
+{
+    if (key.isEmpty())
+        return;
+
+    for (Job &job : m_queue)
+    {
+        if (job.key == key)
+            job.priority = priority;
+    }
+    DecodeScheduler::instance().reprioritize(key, priority);
+    dispatch();
+}
+
+bool
+DecoderPool::drop(const QString &key) noexcept
+{
+    if (key.isEmpty())
+        return false;
+
+    bool dropped = false;
+    for (auto it = m_queue.begin(); it != m_queue.end();)
+    {
+        if (it->key != key)
+        {
+            ++it;
+            continue;
+        }
+        finish(*it, DecodeResult());
+        it      = m_queue.erase(it);
+        dropped = true;
+    }
+    // Jobs decoded in-process are queued on the scheduler instead
+    return DecodeScheduler::instance().drop(key) || dropped;
+}
+
+DecoderPool::Worker *
+DecoderPool::spawnWorker() noexcept
+{
+    Worker *worker  = new Worker;
+    worker->process = new QProcess(this);
+    worker->timer   = new QTimer(this);
+    worker->timer->setSingleShot(true);
+    worker->process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    connect(worker->process, &QProcess::started, this, &DecoderPool::dispatch);
+    connect(worker->process, &QProcess::readyReadStandardOutput, this, [this, worker]() { readReplies(worker); });
+    connect(worker->process, &QProcess::finished, this, [this, worker]() { onWorkerExited(worker); });
+    connect(worker->process, &QProcess::errorOccurred, this, [this, worker](QProcess::ProcessError error)
+    {
+        // No finished() follows a failed start
+        if (error != QProcess::FailedToStart)
+            return;
+
+        qWarning() << "Cannot start decoder workers:" << worker->process->errorString() << "- decoding in-process";
+        m_broken = true;
+        retireWorker(worker);
+        while (!m_queue.isEmpty())
+            decodeInProcess(m_queue.takeFirst());
+    });
+    connect(worker->timer, &QTimer::timeout, this, [worker]()
+    {
+        worker->timedOut = true;
+        worker->process->kill();
+    });
+
+    m_workers.append(worker);
+    worker->process->start(QCoreApplication::applicationFilePath(),
+                           {"--decode-worker", QString::number(m_memory_limit_mb), DecoderSelector::instance().path()});
+    return worker;
+}
+
+// Forget `worker`; one that is still running exits once its stdin is closed
+void
+DecoderPool::retireWorker(Worker *worker) noexcept
+{
+    m_workers.removeOne(worker);
+    disconnect(worker->process, nullptr, this, nullptr);
+    disconnect(worker->timer, nullptr, this, nullptr);
+    worker->timer->deleteLater();
+
+    if (worker->process->state() == QProcess::NotRunning)
+        worker->process->deleteLater();
+    else
+    {
+        connect(worker->process, &QProcess::finished, worker->process, &QObject::deleteLater);
+        worker->process->closeWriteChannel();
+    }
+    delete worker;
+}
+
+void
+DecoderPool::dispatch() noexcept
+{
+    const QList<Worker *> workers = m_workers;
+    for (Worker *worker : workers)
+    {
+        if (m_workers.size() > m_worker_count && !worker->job)
+            retireWorker(worker);
+    }
+
+    while (!m_broken && m_workers.size() < m_worker_count)
+        spawnWorker();
+
+    // One worker is kept for visible jobs when there are several
+    const int backgroundCap = m_worker_count > 1 ? m_worker_count - 1 : m_worker_count;
+    int background          = 0;
+    for (const Worker *worker : m_workers)
+    {
+        if (worker->job && worker->job->priority != DecodeScheduler::Priority::Visible)
+            ++background;
+    }
+
+    for (Worker *worker : m_workers)
+    {
+        if (worker->job || worker->process->state() != QProcess::Running)
+            continue;
+
+        const qsizetype next = nextJob(background < backgroundCap);
+        if (next < 0)
+            break;
+
+        worker->job      = std::make_unique<Job>(m_queue.takeAt(next));
+        worker->timedOut = false;
+        if (worker->job->priority != DecodeScheduler::Priority::Visible)
+            ++background;
+
+        QJsonObject overrides;
+        const QMap<QString, QString> decoders = DecoderSelector::instance().overrides();
+        for (auto it = decoders.cbegin(); it != decoders.cend(); ++it)
+            overrides[it.key()] = it.value();
+
+        const DecodeLimits limits = ImageDecoder::limits();
+        const QJsonObject request{
+            {"id", double(worker->job->id)},
+            {"path", worker->job->filepath},
+            {"mime", worker->job->mimeType},
+            {"segment", worker->job->segment},
+            {"maxBytes", double(limits.maxBytes)},
+            {"maxFrames", limits.maxFrames},
+            {"timeoutMs", limits.timeoutMs},
+            {"decoders", overrides},
+        };
+        worker->process->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+        if (m_timeout_ms > 0)
+            worker->timer->start(m_timeout_ms);
+    }
+}
+
+// Index of the oldest queued job of the most urgent class, -1 when there is
+// none; only visible jobs unless `background`
+qsizetype
+DecoderPool::nextJob(bool background) const noexcept
+{
+    qsizetype next = -1;
+    for (qsizetype i = 0; i < m_queue.size(); ++i)
+    {
+        const DecodeScheduler::Priority priority = m_queue[i].priority;
+        if (!background && priority != DecodeScheduler::Priority::Visible)
+            continue;
+        if (next < 0 || priority < m_queue[next].priority)
+            next = i;
+    }
+    return next;
+}
+
+void
+DecoderPool::readReplies(Worker *worker) noexcept
+{
+    while (worker->process->canReadLine())
+    {
+        const QJsonObject reply = QJsonDocument::fromJson(worker->process->readLine()).object();
+        if (!worker->job || reply.value("id").toDouble() != double(worker->job->id))
+            continue;
+
+        worker->timer->stop();
+        m_failed_starts = 0;
+        std::unique_ptr<Job> job = std::move(worker->job);
+
+        DecodeResult result;
+        result.animated     = reply.value("animated").toBool();
+        result.errorTitle   = reply.value("errorTitle").toString();
+        result.errorMessage = reply.value("errorMessage").toString();
+        result.decoder      = reply.value("decoder").toString();
+        if (reply.contains("fullWidth"))
+            result.fullSize = QSize(reply.value("fullWidth").toInt(), reply.value("fullHeight").toInt());
+        if (reply.contains("width"))
+        {
+            result.image = mapSegment(job->segment, reply.value("width").toInt(), reply.value("height").toInt(),
+                                      qsizetype(reply.value("bytesPerLine").toDouble()),
+                                      QImage::Format(reply.value("format").toInt()));
+            if (result.image.isNull())
+            {
+                result.errorTitle   = "Open File";
+                result.errorMessage = "The decoded image could not be transferred from the decoder process.";
+            }
+        }
+
+        const QJsonObject timing = reply.value("timing").toObject();
+        if (!result.image.isNull() && !timing.isEmpty())
+        {
+            result.timing.format  = timing.value("format").toString();
+            result.timing.pixels  = qint64(timing.value("pixels").toDouble());
+            result.timing.backend = timing.value("backend").toString();
+            result.timing.ns      = qint64(timing.value("ns").toDouble());
+            DecoderSelector::instance().record(result.timing);
+        }
+        finish(*job, result);
+    }
+    dispatch();
+}
+
+void
+DecoderPool::onWorkerExited(Worker *worker) noexcept
+{
+    if (worker->job)
+    {
+        shm_unlink(worker->job->segment.toLocal8Bit().constData());
+
+        DecodeResult result;
+        result.errorTitle = "Open File";
+        if (worker->timedOut)
+            result.errorMessage = QString("Decoding %1 took longer than %2 s and was stopped.")
+                                      .arg(worker->job->filepath)
+                                      .arg(m_timeout_ms / 1000.0);
+        else
+            result.errorMessage = QString("The decoder crashed or ran out of memory on %1.").arg(worker->job->filepath);
+        finish(*worker->job, result);
+    }
+    else if (++m_failed_starts >= MAX_FAILED_STARTS)
+    {
+        qWarning() << "Decoder workers keep exiting, decoding in-process";
+        m_broken = true;
+    }
+
+    retireWorker(worker);
+    if (m_broken)
+    {
+        while (!m_queue.isEmpty())
+            decodeInProcess(m_queue.takeFirst());
+        return;
+    }
+    dispatch();
+}
+
+void
+DecoderPool::decodeInProcess(Job job) noexcept
+{
+    // A task dropped from the scheduler yields a default result, which
+    // finishes the job all the same
+    DecodeScheduler::instance()
+        .run(job.priority, [job]() { return ImageDecoder::decode(job.filepath, job.mimeType); }, job.key)
+        .then([job](const DecodeResult &result) mutable { finish(job, result); });
+}
+
+void
+DecoderPool::finish(Job &job, const DecodeResult &result) noexcept
+{
+    job.promise->addResult(result);
+    job.promise->finish();
+}
+
+// Map the pixels a worker left in `segment`; the QImage unmaps them when its
+// last copy goes away. The name is removed right away, the mapping stays valid.
+QImage
+DecoderPool::mapSegment(const QString &segment, int width, int height, qsizetype bytesPerLine,
+                        QImage::Format format) noexcept
+{
+    const QByteArray key = segment.toLocal8Bit();
+    const int fd         = shm_open(key.constData(), O_RDONLY, 0);
+    shm_unlink(key.constData());
+    if (fd < 0)
+        return {};
+
+    const size_t size = size_t(bytesPerLine) * size_t(height);
+    void *data        = MAP_FAILED;
+    struct stat st;
+    if (width > 0 && height > 0 && fstat(fd, &st) == 0 && size_t(st.st_size) >= size)
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return {};
+
+    return QImage(static_cast<const uchar *>(data), width, height, bytesPerLine, format, unmapSegment,
+                  new Mapping{data, size});
+}
+
+int
+DecoderPool::runWorker(int memoryLimitMb, const QString &statsPath) noexcept
+{
+    // Allocations beyond the limit fail inside this process only; ImageMagick
+    // reports them as errors or the worker dies and is replaced
+    if (memoryLimitMb > 0)
+    {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = rlim_t(memoryLimitMb) * 1024 * 1024;
+        if (setrlimit(RLIMIT_AS, &limit) != 0)
+            qWarning() << "Cannot limit decoder memory:" << std::strerror(errno);
+    }
+
+    ImageDecoder::initialize();
+    if (!statsPath.isEmpty())
+        DecoderSelector::instance().load(statsPath);
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        const QJsonObject request = QJsonDocument::fromJson(QByteArray::fromStdString(line)).object();
+
+        DecodeLimits limits;
+        limits.maxBytes  = qint64(request.value("maxBytes").toDouble(double(limits.maxBytes)));
+        limits.maxFrames = request.value("maxFrames").toInt(limits.maxFrames);
+        limits.timeoutMs = request.value("timeoutMs").toInt(limits.timeoutMs);
+        ImageDecoder::setLimits(limits);
+
+        QMap<QString, QString> overrides;
+        const QJsonObject decoders = request.value("decoders").toObject();
+        for (auto it = decoders.begin(); it != decoders.end(); ++it)
+            overrides[it.key()] = it.value().toString();
+        DecoderSelector::instance().setOverrides(overrides);
+
+        const DecodeResult result =
+            ImageDecoder::decode(request.value("path").toString(), request.value("mime").toString());
+
+        QJsonObject reply{{"id", request.value("id")}};
+        if (!result.decoder.isEmpty())
+            reply["decoder"] = result.decoder;
+        if (!result.timing.backend.isEmpty())
+            reply["timing"] = QJsonObject{
+                {"format", result.timing.format},
+                {"pixels", double(result.timing.pixels)},
+                {"backend", result.timing.backend},
+                {"ns", double(result.timing.ns)},
+            };
+        if (result.animated)
+            reply["animated"] = true;
+        else if (!result.image.isNull())
+        {
+            if (writeSegment(request.value("segment").toString(), result.image))
+            {
+                reply["width"]        = result.image.width();
+                reply["height"]       = result.image.height();
+                reply["bytesPerLine"] = double(result.image.bytesPerLine());
+                reply["format"]       = int(result.image.format());
+                if (result.fullSize.isValid())
+                {
+                    reply["fullWidth"]  = result.fullSize.width();
+                    reply["fullHeight"] = result.fullSize.height();
+                }
+            }
+            else
+            {
+                reply["errorTitle"]   = "Open File";
+                reply["errorMessage"] = QString("Cannot pass the decoded image on: %1").arg(std::strerror(errno));
+            }
+        }
+
+        if (!result.errorTitle.isEmpty())
+        {
+            reply["errorTitle"]   = result.errorTitle;
+            reply["errorMessage"] = result.errorMessage;
+        }
+
+        std::cout << QJsonDocument(reply).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+    }
+    return 0;
+}
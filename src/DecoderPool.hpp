@@ -0,0 +1,97 @@
+#pragma once
+
+#include "DecodeScheduler.hpp"
+#include "ImageDecoder.hpp"
+
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QPromise>
+#include <QTimer>
+#include <memory>
+
+// Decoding in child processes, so that a file that makes ImageMagick allocate
+// without bound, spin or crash takes down a worker instead of the window. The
+// workers are this executable started with --decode-worker; each decodes one
+// file at a time and hands the pixels back in a POSIX shared memory segment
+// that is mapped into the QImage of the result without copying. A job that
+// runs out of time gets its worker killed; workers that die are restarted.
+//
+// Queued jobs are handed out by DecodeScheduler class, visible first, and with
+// more than one worker the last idle one is kept for visible jobs, so the
+// image the user switched to does not wait behind prefetches.
+//
+// Workers only tell that a file is animated; its frames are decoded by the
+// view in this process, bounded by DecodeLimits.
+class DecoderPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DecoderPool(QObject *parent = nullptr) noexcept;
+    ~DecoderPool() noexcept;
+
+    // Number of worker processes, per-file time limit and per-worker address
+    // space limit (0 = none). Workers that are already running keep their
+    // memory limit.
+    void configure(int workers, int timeoutMs, int memoryLimitMb) noexcept;
+
+    // Decode `filepath` in class `priority`. Queued jobs with a `key` can be
+    // moved with reprioritize() and dropped with drop(), as on the scheduler.
+    QFuture<DecodeResult> decode(const QString &filepath, const QString &mimeType,
+                                 DecodeScheduler::Priority priority = DecodeScheduler::Priority::Visible,
+                                 const QString &key = QString()) noexcept;
+
+    // Move the queued jobs with `key` to class `priority`; running ones keep going
+    void reprioritize(const QString &key, DecodeScheduler::Priority priority) noexcept;
+
+    // Drop the queued jobs with `key`; their futures hold a default-constructed
+    // result. True when any job was dropped.
+    bool drop(const QString &key) noexcept;
+
+    // Body of a worker process: serve decode requests from stdin until it is
+    // closed. Returns the exit code. `statsPath` is the DecoderSelector file
+    // of the window; workers read it but leave saving to the window.
+    static int runWorker(int memoryLimitMb, const QString &statsPath) noexcept;
+
+private:
+    struct Job
+    {
+        quint64 id{0};
+        QString filepath;
+        QString mimeType;
+        QString key;
+        DecodeScheduler::Priority priority{DecodeScheduler::Priority::Visible};
+        QString segment; // shared memory name, chosen here so it can be cleaned up after a crash
+        std::shared_ptr<QPromise<DecodeResult>> promise;
+    };
+
+    struct Worker
+    {
+        QProcess *process{nullptr};
+        QTimer *timer{nullptr};
+        std::unique_ptr<Job> job; // null while idle
+        bool timedOut{false};
+    };
+
+    Worker *spawnWorker() noexcept;
+    void retireWorker(Worker *worker) noexcept;
+    void dispatch() noexcept;
+    qsizetype nextJob(bool background) const noexcept;
+    void readReplies(Worker *worker) noexcept;
+    void onWorkerExited(Worker *worker) noexcept;
+    void decodeInProcess(Job job) noexcept;
+
+    static void finish(Job &job, const DecodeResult &result) noexcept;
+    static QImage mapSegment(const QString &segment, int width, int height, qsizetype bytesPerLine,
+                             QImage::Format format) noexcept;
+
+    QList<Worker *> m_workers;
+    QList<Job> m_queue; // oldest first
+    quint64 m_next_id{1};
+    int m_worker_count{0};
+    int m_timeout_ms{30 * 1000};
+    int m_memory_limit_mb{0};
+    int m_failed_starts{0}; // workers in a row that exited without a job
+    bool m_broken{false}; // workers cannot be started, decode in-process
+};
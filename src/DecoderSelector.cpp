@@ -0,0 +1,260 @@
+#include "DecoderSelector.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <climits>
+
+// The stats file is
+//   {"version": 1, "samples": {"png/1-4MP/qt": [12.5, 11.9, ...], ...}}
+// with the decode times in milliseconds, oldest first.
+
+DecoderSelector &
+DecoderSelector::instance() noexcept
+{
+    static DecoderSelector selector;
+    return selector;
+}
+
+void
+DecoderSelector::load(const QString &path) noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    m_path = path;
+
+    QFile file(path);
+    if (!file.exists())
+        return;
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Cannot read decoder stats from" << path << ":" << file.errorString();
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != 1)
+        return;
+
+    const QJsonObject samples = root.value("samples").toObject();
+    for (auto it = samples.begin(); it != samples.end(); ++it)
+    {
+        QVector<double> &times = m_samples[it.key()];
+        times.clear();
+        for (const QJsonValue &value : it.value().toArray())
+        {
+            if (value.toDouble() > 0)
+                times.append(value.toDouble());
+        }
+        if (times.size() > MAX_SAMPLES)
+            times.remove(0, times.size() - MAX_SAMPLES);
+    }
+}
+
+void
+DecoderSelector::save() noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty || m_path.isEmpty())
+        return;
+
+    QJsonObject samples;
+    for (auto it = m_samples.cbegin(); it != m_samples.cend(); ++it)
+    {
+        QJsonArray times;
+        for (double ms : it.value())
+            times.append(ms);
+        samples[it.key()] = times;
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(QJsonObject{{"version", 1}, {"samples", samples}}).toJson()) < 0 || !file.commit())
+    {
+        qWarning() << "Cannot save decoder stats to" << m_path << ":" << file.errorString();
+        return;
+    }
+    m_dirty = false;
+}
+
+QString
+DecoderSelector::path() const noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    return m_path;
+}
+
+void
+DecoderSelector::setOverrides(const QMap<QString, QString> &overrides) noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    m_overrides = overrides;
+}
+
+QMap<QString, QString>
+DecoderSelector::overrides() const noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    return m_overrides;
+}
+
+QString
+DecoderSelector::choose(const QString &mimeType, qint64 pixels, QString &reason) noexcept
+{
+    const QString format = formatOf(mimeType);
+
+    QMutexLocker lock(&m_mutex);
+    QStringList candidates;
+    for (const QString &backend : DecoderSelector::candidates(mimeType))
+    {
+        if (m_failures.value(format + "/" + backend) < MAX_FAILURES)
+            candidates.append(backend);
+    }
+    if (candidates.isEmpty())
+        candidates = DecoderSelector::candidates(mimeType);
+
+    const QString pinned = m_overrides.value(format);
+    if (!pinned.isEmpty() && pinned != "auto")
+    {
+        if (candidates.contains(pinned))
+        {
+            reason = "set in the config";
+            return pinned;
+        }
+        qDebug() << "Decoder" << pinned << "from the config cannot read" << format << "- choosing one";
+    }
+
+    if (candidates.size() == 1)
+    {
+        reason = "the only decoder for this format";
+        return candidates.first();
+    }
+
+    // Warm-up: the backend with the fewest samples goes next
+    QString next;
+    int fewest = INT_MAX;
+    for (const QString &backend : candidates)
+    {
+        const int count = m_samples.value(key(format, pixels, backend)).size();
+        if (count < fewest)
+        {
+            fewest = count;
+            next   = backend;
+        }
+    }
+    if (fewest < WARMUP_SAMPLES)
+    {
+        reason = QString("measuring, %1 of %2 samples").arg(fewest).arg(WARMUP_SAMPLES);
+        return next;
+    }
+
+    QString best;
+    double bestMs = 0;
+    for (const QString &backend : candidates)
+    {
+        const double ms = median(m_samples.value(key(format, pixels, backend)));
+        if (best.isEmpty() || ms < bestMs)
+        {
+            best   = backend;
+            bestMs = ms;
+        }
+    }
+    reason = QString("fastest here, median %1 ms for %2 %3").arg(bestMs, 0, 'f', 1).arg(format, sizeClass(pixels));
+    return best;
+}
+
+void
+DecoderSelector::record(const DecodeTiming &timing) noexcept
+{
+    if (timing.backend.isEmpty() || timing.ns <= 0)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    QVector<double> &times = m_samples[key(timing.format, timing.pixels, timing.backend)];
+    times.append(timing.ns / 1e6);
+    if (times.size() > MAX_SAMPLES)
+        times.removeFirst();
+    m_failures.remove(timing.format + "/" + timing.backend);
+    m_dirty = true;
+}
+
+void
+DecoderSelector::recordFailure(const QString &mimeType, const QString &backend) noexcept
+{
+    QMutexLocker lock(&m_mutex);
+    const int failures = ++m_failures[formatOf(mimeType) + "/" + backend];
+    if (failures == MAX_FAILURES)
+        qDebug() << "Decoder" << backend << "failed on" << failures << formatOf(mimeType)
+                 << "files in a row, not choosing it for them any more";
+}
+
+QString
+DecoderSelector::formatOf(const QString &mimeType) noexcept
+{
+    QString format = mimeType.section('/', 1);
+    if (format.startsWith("x-"))
+        format.remove(0, 2);
+    return format;
+}
+
+QStringList
+DecoderSelector::candidates(const QString &mimeType) noexcept
+{
+    static const QSet<QByteArray> qtTypes = []()
+    {
+        const QList<QByteArray> types = QImageReader::supportedMimeTypes();
+        return QSet<QByteArray>(types.begin(), types.end());
+    }();
+
+    QStringList backends;
+#ifdef HAS_LIBAVIF
+    if (mimeType == "image/avif")
+        backends << "avif";
+#endif
+    backends << "magick";
+    if (qtTypes.contains(mimeType.toLatin1()))
+        backends << "qt";
+    return backends;
+}
+
+QString
+DecoderSelector::sizeClass(qint64 pixels) noexcept
+{
+    if (pixels < 0)
+        return "unknown";
+
+    constexpr qint64 MP = 1000 * 1000;
+    if (pixels < MP)
+        return "<1MP";
+    if (pixels < 4 * MP)
+        return "1-4MP";
+    if (pixels < 16 * MP)
+        return "4-16MP";
+    if (pixels < 64 * MP)
+        return "16-64MP";
+    return ">64MP";
+}
+
+QString
+DecoderSelector::key(const QString &format, qint64 pixels, const QString &backend) noexcept
+{
+    return format + "/" + sizeClass(pixels) + "/" + backend;
+}
+
+double
+DecoderSelector::median(QVector<double> samples) noexcept
+{
+    if (samples.isEmpty())
+        return 0;
+
+    const auto middle = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), middle, samples.end());
+    return *middle;
+}
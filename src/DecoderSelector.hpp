@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ImageDecoder.hpp"
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Which backend decodes a format. Every decode is timed and kept per format,
+// size class and backend; once each backend that can read a format has a few
+// samples for a size class, that class goes to the one with the lowest
+// median. Until then the backends take turns. The [decoders] table of the
+// config pins a format to a backend instead.
+//
+// Backends are named "qt" (QImageReader), "magick" (ImageMagick) and "avif"
+// (libavif, when built with it).
+class DecoderSelector
+{
+public:
+    static DecoderSelector &instance() noexcept;
+
+    // Read the samples kept in `path`; save() writes them back there
+    void load(const QString &path) noexcept;
+    void save() noexcept;
+    QString path() const noexcept;
+
+    // Format ("png", "jpeg", ...) to backend; "auto" or a missing format means measured
+    void setOverrides(const QMap<QString, QString> &overrides) noexcept;
+    QMap<QString, QString> overrides() const noexcept;
+
+    // Backend for the next decode of a file of `mimeType` with `pixels` (-1
+    // when unknown), and in `reason` why it was chosen
+    QString choose(const QString &mimeType, qint64 pixels, QString &reason) noexcept;
+    void record(const DecodeTiming &timing) noexcept;
+
+    // `backend` failed on a file of `mimeType` that another one read. One bad
+    // file says little about the format; after MAX_FAILURES of them in a row,
+    // with no file of the format read by it in between, the backend is not
+    // chosen for that format again in this process.
+    void recordFailure(const QString &mimeType, const QString &backend) noexcept;
+
+    // Backends that can read `mimeType`, the default of the viewer first
+    static QStringList candidates(const QString &mimeType) noexcept;
+    static QString formatOf(const QString &mimeType) noexcept;
+
+private:
+    static constexpr int WARMUP_SAMPLES = 3;  // per backend and size class before choosing by speed
+    static constexpr int MAX_SAMPLES    = 32; // most recent ones kept
+    static constexpr int MAX_FAILURES   = 3;  // in a row before a backend is given up on for a format
+
+    DecoderSelector() noexcept = default;
+
+    static QString sizeClass(qint64 pixels) noexcept;
+    static QString key(const QString &format, qint64 pixels, const QString &backend) noexcept;
+    static double median(QVector<double> samples) noexcept;
+
+    mutable QMutex m_mutex;
+    QString m_path;
+    QMap<QString, QString> m_overrides;
+    QHash<QString, QVector<double>> m_samples; // "format/class/backend" to milliseconds, oldest first
+    QHash<QString, int> m_failures;            // "format/backend" to failures since its last success
+    bool m_dirty{false};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ImageDocument.hpp"
+
+#include <QVBoxLayout>
+#include <QWidget>
+
+// Tab page for one document. It only hosts the window's ImageView while the
+// tab is current, so a background tab costs little more than its document.
+class DocumentTab : public QWidget
+{
+public:
+    DocumentTab(const ImageDocument &document, QWidget *parent = nullptr) : QWidget(parent), m_document(document)
+    {
+        auto *layout = new QVBoxLayout(this);
+        layout->setContentsMargins(0, 0, 0, 0);
+    }
+
+    inline ImageDocument &document() noexcept
+    {
+        return m_document;
+    }
+
+    inline void attachView(QWidget *view) noexcept
+    {
+        layout()->addWidget(view);
+        view->show();
+    }
+
+    // Whether the file has been added to the recent files list
+    inline bool recorded() const noexcept
+    {
+        return m_recorded;
+    }
+
+    inline void setRecorded(bool recorded) noexcept
+    {
+        m_recorded = recorded;
+    }
+
+private:
+    ImageDocument m_document;
+    bool m_recorded{false};
+};
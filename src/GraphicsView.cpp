@@ -1,5 +1,7 @@
 #include "GraphicsView.hpp"
 
+#include "Trace.hpp"
+
 #include <QCursor>
 #include <qevent.h>
 #include <qnamespace.h>
@@ -17,11 +19,41 @@ GraphicsView::GraphicsView(QWidget *parent) : QGraphicsView(parent)
     setAcceptDrops(false);
     setFrameShadow(QFrame::Shadow::Plain);
     setFrameStyle(QFrame::NoFrame);
+
+    m_interaction_timer = new QTimer(this);
+    m_interaction_timer->setSingleShot(true);
+    m_interaction_timer->setInterval(150);
+    connect(m_interaction_timer, &QTimer::timeout, this, &GraphicsView::endInteraction);
+}
+
+void
+GraphicsView::beginInteraction() noexcept
+{
+    m_interaction_timer->start();
+
+    if (m_interacting)
+        return;
+
+    m_interacting = true;
+    emit interactionStarted();
+}
+
+void
+GraphicsView::endInteraction() noexcept
+{
+    // A drag that is held still is still an interaction
+    if (m_dragging)
+        return;
+
+    m_interacting = false;
+    emit interactionFinished();
 }
 
 void
 GraphicsView::wheelEvent(QWheelEvent *event)
 {
+    beginInteraction();
+
     if (event->modifiers() & Qt::ControlModifier)
     {
         if (event->angleDelta().y() > 0)
@@ -38,25 +70,68 @@ void
 GraphicsView::mousePressEvent(QMouseEvent *e)
 {
     QGuiApplication::setOverrideCursor(Qt::CursorShape::ClosedHandCursor);
+    m_dragging = true;
+    beginInteraction();
     QGraphicsView::mousePressEvent(e);
 }
 
+void
+GraphicsView::mouseMoveEvent(QMouseEvent *e)
+{
+    if (m_dragging)
+        beginInteraction();
+    QGraphicsView::mouseMoveEvent(e);
+}
+
 void
 GraphicsView::mouseReleaseEvent(QMouseEvent *e)
 {
     QGraphicsView::mouseReleaseEvent(e);
     QGuiApplication::restoreOverrideCursor();
+    m_dragging = false;
+    beginInteraction(); // restart the idle period from the release
+}
+
+void
+GraphicsView::paintEvent(QPaintEvent *e)
+{
+    IV_TRACE_SCOPE("GraphicsView::paintEvent");
+
+    QGraphicsView::paintEvent(e);
+
+    // Every scroll, zoom or resize ends up here exactly once per frame, so
+    // comparing against the last rect coalesces all of them into one
+    // notification. It is queued so that listeners never run inside a paint.
+    const QRectF rect = visibleSceneRect();
+    if (rect == m_last_viewport_rect)
+        return;
+
+    m_last_viewport_rect = rect;
+    if (m_viewport_change_pending)
+        return;
+
+    m_viewport_change_pending = true;
+    QMetaObject::invokeMethod(this, [this]() { emitViewportChanged(); }, Qt::QueuedConnection);
+}
+
+void
+GraphicsView::emitViewportChanged() noexcept
+{
+    m_viewport_change_pending = false;
+    emit viewportChanged(m_last_viewport_rect);
 }
 
 void
 GraphicsView::zoomIn() noexcept
 {
+    beginInteraction();
     scale(m_zoomFactor, m_zoomFactor);
 }
 
 void
 GraphicsView::zoomOut() noexcept
 {
+    beginInteraction();
     scale(1.0 / m_zoomFactor, 1.0 / m_zoomFactor);
 }
 
@@ -74,6 +149,7 @@ GraphicsView::nativeGestureEvent(QNativeGestureEvent *event) noexcept
     {
         if (event->gestureType() == Qt::ZoomNativeGesture)
         {
+            beginInteraction();
             if (event->value() > 0)
                 emit zoomInRequested();
             else
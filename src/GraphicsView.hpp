@@ -5,6 +5,7 @@
 #include <QNativeGestureEvent>
 #include <QGraphicsView>
 #include <QMimeData>
+#include <QTimer>
 #include <QWheelEvent>
 #include <qevent.h>
 
@@ -26,12 +27,35 @@ public:
     void zoomOut() noexcept;
     void zoomReset() noexcept;
 
+    // Mark the view as being interacted with (wheel, pinch, drag, minimap
+    // overlay). The interaction ends once no further call arrives for a short
+    // idle period.
+    void beginInteraction() noexcept;
+
+    inline bool isInteracting() const noexcept
+    {
+        return m_interacting;
+    }
+
+    // Currently visible region of the scene
+    inline QRectF visibleSceneRect() const noexcept
+    {
+        return mapToScene(viewport()->rect()).boundingRect();
+    }
+
 signals:
     void openFilesRequested(const QList<QString> &files);
     void zoomInRequested();
     void zoomOutRequested();
     void zoomResetRequested();
 
+    // Emitted at most once per painted frame whenever the visible scene rect
+    // changes (scroll, zoom, rotation, resize)
+    void viewportChanged(const QRectF &sceneRect);
+
+    void interactionStarted();
+    void interactionFinished();
+
 protected:
     bool event(QEvent *event) override
     {
@@ -42,8 +66,18 @@ protected:
     void wheelEvent(QWheelEvent *e) override;
     void mousePressEvent(QMouseEvent *e) override;
     void mouseReleaseEvent(QMouseEvent *e) override;
+    void mouseMoveEvent(QMouseEvent *e) override;
+    void paintEvent(QPaintEvent *e) override;
 
 private:
     float m_zoomFactor{1.25f};
     bool nativeGestureEvent(QNativeGestureEvent *event) noexcept;
+    void emitViewportChanged() noexcept;
+    void endInteraction() noexcept;
+
+    QRectF m_last_viewport_rect;
+    bool m_viewport_change_pending{false};
+
+    QTimer *m_interaction_timer{nullptr};
+    bool m_interacting{false}, m_dragging{false};
 };
@@ -0,0 +1,150 @@
+#include "ImageCache.hpp"
+
+#include <QFileInfo>
+
+QFuture<DecodeResult>
+ImageCache::decode(const QString &filepath, const QString &mimeType) noexcept
+{
+    const QDateTime modified = QFileInfo(filepath).lastModified();
+
+    auto it = m_entries.find(filepath);
+    if (it != m_entries.end())
+    {
+        if (it->modified == modified && !stale(*it))
+        {
+            // Wanted on screen now: a queued prefetch jumps the queue
+            if (it->prefetch)
+            {
+                it->prefetch    = false;
+                it->cancellable = false;
+                if (m_pool)
+                    m_pool->reprioritize(filepath, DecodeScheduler::Priority::Visible);
+                else
+                    DecodeScheduler::instance().reprioritize(filepath, DecodeScheduler::Priority::Visible);
+            }
+
+            m_lru.removeOne(filepath);
+            m_lru.prepend(filepath);
+            return it->future;
+        }
+
+        m_entries.erase(it);
+        m_lru.removeOne(filepath);
+    }
+
+    return start(filepath, mimeType, false, false);
+}
+
+QFuture<DecodeResult>
+ImageCache::start(const QString &filepath, const QString &mimeType, bool prefetch, bool cancellable) noexcept
+{
+    const DecodeScheduler::Priority priority =
+        prefetch ? DecodeScheduler::Priority::Prefetch : DecodeScheduler::Priority::Visible;
+
+    Entry entry;
+    entry.modified    = QFileInfo(filepath).lastModified();
+    entry.prefetch    = prefetch;
+    entry.cancellable = prefetch && cancellable;
+    if (m_pool)
+        entry.future = m_pool->decode(filepath, mimeType, priority, filepath);
+    else
+        entry.future = DecodeScheduler::instance().run(
+            priority, [filepath, mimeType]() { return ImageDecoder::decode(filepath, mimeType); }, filepath);
+
+    m_entries.insert(filepath, entry);
+    m_lru.removeOne(filepath);
+    m_lru.prepend(filepath);
+    evict();
+
+    return entry.future;
+}
+
+void
+ImageCache::prefetch(const QString &filepath, bool cancellable) noexcept
+{
+    const auto it = m_entries.constFind(filepath);
+    if ((it != m_entries.cend() && !stale(*it)) || !QFileInfo::exists(filepath))
+        return;
+
+    // The type is looked up by the decode, off this thread
+    start(filepath, QString(), true, cancellable);
+}
+
+void
+ImageCache::cancelPrefetches() noexcept
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        if (it->cancellable && !it->future.isFinished() &&
+            (m_pool ? m_pool->drop(it.key()) : DecodeScheduler::instance().drop(it.key())))
+        {
+            m_lru.removeOne(it.key());
+            it = m_entries.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+// A failed decode is retried; one in flight is joined
+bool
+ImageCache::stale(const Entry &entry) noexcept
+{
+    return entry.future.isFinished() && !entry.future.result().ok();
+}
+
+void
+ImageCache::insert(const QString &filepath, const QFuture<DecodeResult> &future) noexcept
+{
+    m_lru.removeOne(filepath);
+    m_entries.insert(filepath, { future, QFileInfo(filepath).lastModified() });
+    m_lru.prepend(filepath);
+    evict();
+}
+
+void
+ImageCache::remove(const QString &filepath) noexcept
+{
+    m_entries.remove(filepath);
+    m_lru.removeOne(filepath);
+}
+
+qint64
+ImageCache::bytes(const QSet<qint64> &shared) const noexcept
+{
+    qint64 total = 0;
+    for (const Entry &entry : m_entries)
+    {
+        if (!entry.future.isFinished())
+            continue;
+
+        const QImage image = entry.future.result().image;
+        if (!shared.contains(image.cacheKey()))
+            total += image.sizeInBytes();
+    }
+    return total;
+}
+
+// Decodes still in flight are not counted; they are sized once they finish
+// and are looked at by a later call
+void
+ImageCache::evict() noexcept
+{
+    qint64 total = 0;
+    for (auto it = m_lru.begin(); it != m_lru.end();)
+    {
+        const Entry &entry = m_entries[*it];
+        if (entry.future.isFinished())
+        {
+            const qint64 bytes = entry.future.result().image.sizeInBytes();
+            if (total + bytes > m_budget && it != m_lru.begin())
+            {
+                m_entries.remove(*it);
+                it = m_lru.erase(it);
+                continue;
+            }
+            total += bytes;
+        }
+        ++it;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "DecodeScheduler.hpp"
+#include "DecoderPool.hpp"
+#include "ImageDecoder.hpp"
+
+#include <QDateTime>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+// Decode results by file path, shared by all views of a window. Decodes run on
+// the DecodeScheduler or the DecoderPool, prefetches at a lower priority; a
+// request for a file that is already being decoded (e.g. prefetched for a
+// neighbouring tab) joins the running decode and moves it up to the visible
+// class. Entries are dropped once the file changes on disk, and least
+// recently used entries are evicted beyond the byte budget.
+class ImageCache
+{
+public:
+    static constexpr qint64 DEFAULT_BUDGET = 512ll * 1024 * 1024;
+
+    ImageCache(qint64 budget = DEFAULT_BUDGET) noexcept : m_budget(budget)
+    {
+    }
+
+    inline void setBudget(qint64 bytes) noexcept
+    {
+        m_budget = bytes;
+        evict();
+    }
+
+    // Decode in the worker processes of `pool` instead of on the scheduler;
+    // null goes back to decoding in-process
+    inline void setDecoderPool(DecoderPool *pool) noexcept
+    {
+        m_pool = pool;
+    }
+
+    QFuture<DecodeResult> decode(const QString &filepath, const QString &mimeType) noexcept;
+
+    // Start decoding `filepath` in the background if it is not cached yet.
+    // Unless `cancellable` is false, cancelPrefetches() may drop it again.
+    void prefetch(const QString &filepath, bool cancellable = true) noexcept;
+
+    // Drop the cancellable prefetches that have not started yet, before
+    // queueing the ones for a new current tab. Running ones finish into the
+    // cache.
+    void cancelPrefetches() noexcept;
+
+    // Adopt a decode of `filepath` that was started elsewhere (at startup)
+    void insert(const QString &filepath, const QFuture<DecodeResult> &future) noexcept;
+
+    void remove(const QString &filepath) noexcept;
+
+    // Bytes held by finished decodes, leaving out the images (by cacheKey())
+    // that are `shared` with their documents and counted there
+    qint64 bytes(const QSet<qint64> &shared = {}) const noexcept;
+
+private:
+    struct Entry
+    {
+        QFuture<DecodeResult> future;
+        QDateTime modified;
+        bool prefetch{false};    // queued at prefetch priority
+        bool cancellable{false}; // see cancelPrefetches()
+    };
+
+    void evict() noexcept;
+    static bool stale(const Entry &entry) noexcept;
+    QFuture<DecodeResult> start(const QString &filepath, const QString &mimeType, bool prefetch,
+                                bool cancellable) noexcept;
+
+    QHash<QString, Entry> m_entries;
+    QList<QString> m_lru; // most recently used first
+    qint64 m_budget;
+    DecoderPool *m_pool{nullptr};
+};
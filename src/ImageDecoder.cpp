@@ -0,0 +1,663 @@
+#include "ImageDecoder.hpp"
+
+#include "DecoderSelector.hpp"
+#include "Magick++/Exception.h"
+#include "PixelOps.hpp"
+#include "Trace.hpp"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QMimeDatabase>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#ifdef HAS_LIBAVIF
+#include <avif/avif.h>
+#endif
+
+namespace
+{
+std::once_flag s_magick_once;
+std::atomic<bool> s_magick_ready{false};
+
+std::mutex s_limits_mutex;
+DecodeLimits s_limits;
+
+// Stops an ImageMagick decode once its deadline has passed. Coders report
+// their progress row by row and give up when the monitor returns false; some
+// return what they have so far, so the caller checks expired() as well.
+class Watchdog
+{
+public:
+    explicit Watchdog(int timeoutMs) noexcept
+        : m_deadline(timeoutMs > 0 ? QDeadlineTimer(timeoutMs) : QDeadlineTimer(QDeadlineTimer::Forever))
+    {
+    }
+
+    void attach(Magick::Image &image) noexcept
+    {
+        if (!m_deadline.isForever())
+            MagickCore::SetImageInfoProgressMonitor(image.imageInfo(), &Watchdog::monitor, this);
+    }
+
+    bool expired() const noexcept
+    {
+        return m_expired.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Called from ImageMagick's OpenMP threads as well
+    static MagickCore::MagickBooleanType monitor(const char *, const MagickCore::MagickOffsetType,
+                                                 const MagickCore::MagickSizeType, void *data)
+    {
+        Watchdog *watchdog = static_cast<Watchdog *>(data);
+        if (!watchdog->m_deadline.hasExpired())
+            return MagickCore::MagickTrue;
+
+        watchdog->m_expired.store(true, std::memory_order_relaxed);
+        return MagickCore::MagickFalse;
+    }
+
+    QDeadlineTimer m_deadline;
+    std::atomic<bool> m_expired{false};
+};
+
+void
+reportTimeout(DecodeResult &result, const QString &filepath, int timeoutMs) noexcept
+{
+    result.image        = QImage();
+    result.errorTitle   = "Open File";
+    result.errorMessage =
+        QString("Decoding %1 took longer than %2 s and was stopped.").arg(filepath).arg(timeoutMs / 1000.0);
+}
+
+// Bytes of a decoded frame of `size`, see PixelOps::normalize()
+qint64
+decodedBytes(const QSize &size) noexcept
+{
+    return qint64(size.width()) * size.height() * 4;
+}
+
+// Largest size with the aspect ratio of `size` whose pixels fit in `maxBytes`
+QSize
+fittingSize(const QSize &size, qint64 maxBytes) noexcept
+{
+    const double scale = std::sqrt(double(maxBytes) / double(decodedBytes(size)));
+    return QSize(std::max(1, int(size.width() * scale)), std::max(1, int(size.height() * scale)));
+}
+
+// ImageMagick's pixel cache keeps this much in memory, across all decodes,
+// and moves to memory mapped files and then disk beyond it. Images are held
+// at 16 bits per channel while they are read, twice their size as a QImage,
+// and a few decodes run at once.
+constexpr qint64 MAGICK_MEMORY_PER_LIMIT = 4;
+} // namespace
+
+void
+ImageDecoder::initialize() noexcept
+{
+    std::call_once(s_magick_once, []()
+    {
+        IV_TRACE_SCOPE("Magick::InitializeMagick");
+        Magick::InitializeMagick(nullptr);
+
+        const qint64 maxBytes = limits().maxBytes;
+        if (maxBytes > 0)
+            Magick::ResourceLimits::memory(MagickCore::MagickSizeType(maxBytes * MAGICK_MEMORY_PER_LIMIT));
+        s_magick_ready.store(true, std::memory_order_release);
+    });
+}
+
+void
+ImageDecoder::setLimits(const DecodeLimits &limits) noexcept
+{
+    {
+        std::lock_guard lock(s_limits_mutex);
+        s_limits = limits;
+    }
+
+    // Qt's readers refuse larger allocations on their own; 0 lifts the limit
+    QImageReader::setAllocationLimit(int(std::max<qint64>(0, limits.maxBytes) / (1024 * 1024)));
+
+    if (initialized() && limits.maxBytes > 0)
+        Magick::ResourceLimits::memory(MagickCore::MagickSizeType(limits.maxBytes * MAGICK_MEMORY_PER_LIMIT));
+}
+
+DecodeLimits
+ImageDecoder::limits() noexcept
+{
+    std::lock_guard lock(s_limits_mutex);
+    return s_limits;
+}
+
+bool
+ImageDecoder::probe(const QString &filepath, ImageProbe &info) noexcept
+{
+    IV_TRACE_SCOPE_DETAIL("ImageDecoder::probe", filepath);
+
+    QImageReader reader(filepath);
+    if (reader.canRead() && reader.size().isValid())
+    {
+        info.size   = reader.size();
+        info.frames = reader.supportsAnimation() ? std::max(1, reader.imageCount()) : 1;
+        return true;
+    }
+
+    // Formats Qt cannot read: ImageMagick reads as little as the coder allows,
+    // of every frame so that multi-page files are held to maxFrames as well
+    initialize();
+    try
+    {
+        std::vector<Magick::Image> frames;
+        Magick::ReadOptions options;
+        options.ping(true);
+        Magick::readImages(&frames, filepath.toStdString(), options);
+        if (frames.empty())
+            return false;
+
+        info.size   = QSize(int(std::min<size_t>(frames.front().columns(), INT_MAX)),
+                            int(std::min<size_t>(frames.front().rows(), INT_MAX)));
+        info.frames = int(std::min<size_t>(frames.size(), INT_MAX));
+        return !info.size.isEmpty();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+bool
+ImageDecoder::initialized() noexcept
+{
+    return s_magick_ready.load(std::memory_order_acquire);
+}
+
+QImage
+ImageDecoder::magickImageToQImage(Magick::Image &image) noexcept
+{
+    IV_TRACE_SCOPE("ImageDecoder::magickImageToQImage");
+
+    const int width  = image.columns();
+    const int height = image.rows();
+
+    // Export straight into the destination in ARGB32 memory order, alpha is
+    // opaque for images without an alpha channel
+    QImage img(width, height, QImage::Format_ARGB32);
+    if (img.isNull())
+        return {};
+
+    try
+    {
+        if (img.bytesPerLine() == qsizetype(width) * 4)
+            image.write(0, 0, width, height, "BGRA", Magick::CharPixel, img.bits());
+        else
+        {
+            for (int y = 0; y < height; ++y)
+                image.write(0, y, width, 1, "BGRA", Magick::CharPixel, img.scanLine(y));
+        }
+    }
+    catch (...)
+    {
+        return QImage();
+    }
+
+    if (!image.alpha())
+    {
+        img.reinterpretAsFormat(QImage::Format_RGB32);
+        return img;
+    }
+
+    IV_TRACE_SCOPE("PixelOps::normalize");
+    return PixelOps::normalize(std::move(img));
+}
+
+QVector<QImage>
+ImageDecoder::decodeFrames(const QString &filepath, QVector<int> &delays) noexcept
+{
+    IV_TRACE_SCOPE_DETAIL("ImageDecoder::decodeFrames", filepath);
+
+    QImageReader reader(filepath);
+    QVector<QImage> frames;
+    delays.clear();
+
+    const int maxFrames = limits().maxFrames;
+    while (reader.canRead() && (maxFrames <= 0 || frames.size() < maxFrames))
+    {
+        QImage image = reader.read();
+        if (image.isNull())
+            break;
+
+        int delay = reader.nextImageDelay();
+        if (delay <= 0)
+            delay = 100; // Default 100ms
+
+        frames.append(PixelOps::normalize(std::move(image)));
+        delays.append(delay);
+    }
+
+    return frames;
+}
+
+#ifdef HAS_LIBAVIF
+QImage
+ImageDecoder::avifToQImage(const QString &filepath, QString *error) noexcept
+{
+    IV_TRACE_SCOPE("ImageDecoder::avifToQImage");
+
+    auto fail = [error](const QString &message)
+    {
+        qCritical() << message;
+        if (error)
+            *error = message;
+        return QImage();
+    };
+
+    std::string filename = filepath.toStdString();
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return fail("Failed to open file");
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    std::vector<uint8_t> buffer(size);
+    if (!file.read(reinterpret_cast<char *>(buffer.data()), size))
+        return fail("Failed to read file");
+
+    // Set up decoder
+    avifDecoder *decoder = avifDecoderCreate();
+    avifResult result    = avifDecoderSetIOMemory(decoder, buffer.data(), buffer.size());
+    if (result != AVIF_RESULT_OK)
+    {
+        avifDecoderDestroy(decoder);
+        return fail(avifResultToString(result));
+    }
+
+    result = avifDecoderParse(decoder);
+    if (result != AVIF_RESULT_OK)
+    {
+        avifDecoderDestroy(decoder);
+        return fail(avifResultToString(result));
+    }
+
+    {
+        IV_TRACE_SCOPE("avifDecoderNextImage");
+        result = avifDecoderNextImage(decoder);
+    }
+    if (result != AVIF_RESULT_OK)
+    {
+        qCritical() << "Failed to decode AVIF image: " << avifResultToString(result);
+        avifDecoderDestroy(decoder);
+        return QImage();
+    }
+
+    // Have libavif write premultiplied BGRA (ARGB32_Premultiplied in memory)
+    // directly into the QImage instead of going through a temporary buffer
+    QImage img(decoder->image->width, decoder->image->height, QImage::Format_ARGB32_Premultiplied);
+    if (img.isNull())
+    {
+        avifDecoderDestroy(decoder);
+        return QImage();
+    }
+
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, decoder->image);
+    rgb.format              = AVIF_RGB_FORMAT_BGRA;
+    rgb.depth               = 8;
+    rgb.alphaPremultiplied  = AVIF_TRUE;
+    rgb.pixels              = img.bits();
+    rgb.rowBytes            = static_cast<uint32_t>(img.bytesPerLine());
+
+    {
+        IV_TRACE_SCOPE("avifImageYUVToRGB");
+        result = avifImageYUVToRGB(decoder->image, &rgb);
+    }
+    const bool opaque = decoder->alphaPresent == AVIF_FALSE;
+    avifDecoderDestroy(decoder);
+
+    if (result != AVIF_RESULT_OK)
+        return fail(avifResultToString(result));
+
+    if (opaque)
+        img.reinterpretAsFormat(QImage::Format_RGB32);
+
+    return img;
+}
+#endif
+
+DecodeResult
+ImageDecoder::decode(const QString &filepath, const QString &fileMimeType) noexcept
+{
+    IV_TRACE_SCOPE_DETAIL("ImageDecoder::decode", filepath);
+
+    const QString mimeType = fileMimeType.isEmpty() ? QMimeDatabase().mimeTypeForFile(filepath).name() : fileMimeType;
+
+    DecodeResult result;
+    const DecodeLimits limits = ImageDecoder::limits();
+
+    // What the header promises, before anything is allocated for it. When
+    // nothing can tell the size up front, nothing is decoded unchecked.
+    ImageProbe info;
+    if (!probe(filepath, info))
+        return decodeFirstFrame(filepath, limits);
+
+    const qint64 bytes  = decodedBytes(info.size);
+    const bool oversize = limits.maxBytes > 0 && bytes > limits.maxBytes;
+
+    // Animations are played back frame by frame by the view, which holds all
+    // of them. Too many or too large ones are shown as their first frame.
+    if (QImageReader(filepath).supportsAnimation())
+    {
+        const bool tooManyFrames = limits.maxFrames > 0 && info.frames > limits.maxFrames;
+        const bool tooLarge      = limits.maxBytes > 0 && bytes * info.frames > limits.maxBytes;
+        if (!tooManyFrames && !tooLarge)
+        {
+            result.animated = true;
+            result.decoder  = "qt (animation)";
+            return result;
+        }
+        // An oversize first frame is left to decodeDownscaled()
+        if (!oversize)
+        {
+            QImage first = QImageReader(filepath).read();
+            if (!first.isNull())
+            {
+                result.image   = PixelOps::normalize(std::move(first));
+                result.decoder = "qt (first frame only)";
+                return result;
+            }
+        }
+    }
+
+    if (oversize)
+        return decodeDownscaled(filepath, info.size, limits);
+
+    // Multi-page files that are no animation to Qt (TIFF, PDF, ...) show
+    // their first page; beyond the limits the rest is not decoded at all
+    if (info.frames > 1 && ((limits.maxFrames > 0 && info.frames > limits.maxFrames) ||
+                            (limits.maxBytes > 0 && bytes * info.frames > limits.maxBytes)))
+        return decodeFirstFrame(filepath, limits);
+
+    // The backend DecoderSelector picks; when it cannot read the file the
+    // others try. The ones that failed where another succeeded are counted
+    // against the format, which only a run of such files gives up on.
+    DecoderSelector &selector = DecoderSelector::instance();
+    const qint64 pixels       = qint64(info.size.width()) * info.size.height();
+
+    QString reason;
+    const QString chosen = selector.choose(mimeType, pixels, reason);
+    QStringList backends = DecoderSelector::candidates(mimeType);
+    backends.removeOne(chosen);
+    backends.prepend(chosen);
+
+    QElapsedTimer total;
+    total.start();
+    QStringList failed;
+    for (const QString &backend : backends)
+    {
+        DecodeResult attempt;
+        QElapsedTimer timer;
+        timer.start();
+        decodeWith(backend, filepath, limits, attempt);
+
+        if (attempt.image.isNull())
+        {
+            qDebug() << "Decoder" << backend << "cannot read" << filepath;
+            if (failed.isEmpty())
+                result = attempt;
+            failed.append(backend);
+            if (limits.timeoutMs > 0 && total.hasExpired(limits.timeoutMs))
+                break;
+            continue;
+        }
+
+        for (const QString &loser : failed)
+            selector.recordFailure(mimeType, loser);
+
+        result.image          = std::move(attempt.image);
+        result.errorTitle     = QString();
+        result.errorMessage   = QString();
+        result.decoder        = backend == chosen ? QString("%1 (%2)").arg(backend, reason)
+                                                  : QString("%1 (%2 could not read it)").arg(backend, chosen);
+        result.timing.format  = DecoderSelector::formatOf(mimeType);
+        result.timing.pixels  = pixels;
+        result.timing.backend = backend;
+        result.timing.ns      = timer.nsecsElapsed();
+        selector.record(result.timing);
+        break;
+    }
+    return result;
+}
+
+// One attempt at `filepath` with the DecoderSelector backend `backend`
+void
+ImageDecoder::decodeWith(const QString &backend, const QString &filepath, const DecodeLimits &limits,
+                         DecodeResult &result) noexcept
+{
+#ifdef HAS_LIBAVIF
+    if (backend == "avif")
+    {
+        QString error;
+        result.image = avifToQImage(filepath, &error);
+        if (result.image.isNull() && !error.isEmpty())
+        {
+            result.errorTitle   = "Open File";
+            result.errorMessage = error;
+        }
+        return;
+    }
+#endif
+
+    if (backend == "qt")
+    {
+        IV_TRACE_SCOPE("QImageReader::read");
+
+        // Pixels as stored, like ImageMagick gives them
+        QImageReader reader(filepath);
+        reader.setAutoTransform(false);
+        QImage img = reader.read();
+        if (img.isNull())
+        {
+            result.errorTitle   = "Open File";
+            result.errorMessage = reader.errorString();
+            return;
+        }
+        result.image = PixelOps::normalize(std::move(img));
+        return;
+    }
+
+    initialize();
+
+    Magick::Image image;
+    Watchdog watchdog(limits.timeoutMs);
+    watchdog.attach(image);
+
+    const bool read = readMagick(image, filepath, result);
+    if (watchdog.expired())
+    {
+        reportTimeout(result, filepath, limits.timeoutMs);
+        return;
+    }
+    if (!read)
+        return;
+
+    result.image = magickImageToQImage(image);
+}
+
+// A file whose decoded pixels would exceed limits.maxBytes, decoded at the
+// largest size within it. Formats that can decode at a reduced size (JPEG
+// scales while decoding) never hold the full image; for the others the pixel
+// cache of ImageMagick spills to disk beyond its memory limit and is scaled
+// down from there.
+DecodeResult
+ImageDecoder::decodeDownscaled(const QString &filepath, const QSize &size, const DecodeLimits &limits) noexcept
+{
+    IV_TRACE_SCOPE_DETAIL("ImageDecoder::decodeDownscaled", filepath);
+
+    DecodeResult result;
+    result.fullSize = size;
+
+    const QSize target = fittingSize(size, limits.maxBytes);
+
+    QImageReader reader(filepath);
+    if (reader.supportsOption(QImageIOHandler::ScaledSize))
+    {
+        reader.setScaledSize(target);
+        QImage img = reader.read();
+        if (!img.isNull())
+        {
+            result.image   = PixelOps::normalize(std::move(img));
+            result.decoder = "qt (scaled while reading)";
+            return result;
+        }
+    }
+
+    initialize();
+
+    Magick::Image image;
+    Watchdog watchdog(limits.timeoutMs);
+    watchdog.attach(image);
+
+    // The first frame only of a multi-frame file, which ImageMagick would
+    // otherwise decode in full before any of them could be dropped
+    image.subImage(0);
+    image.subRange(1);
+
+    // Lets the JPEG coder decode at a fraction of the size
+    image.defineValue("jpeg", "size", QString("%1x%2").arg(target.width()).arg(target.height()).toStdString());
+
+    bool read = readMagick(image, filepath, result);
+    if (read && (image.columns() > size_t(target.width()) || image.rows() > size_t(target.height())))
+    {
+        try
+        {
+            IV_TRACE_SCOPE("Magick::Image::scale");
+            image.scale(Magick::Geometry(target.width(), target.height()));
+        }
+        catch (const std::exception &e)
+        {
+            qDebug() << "Cannot scale down" << filepath << ":" << e.what();
+            result.errorTitle   = "Open File";
+            result.errorMessage = QString("%1 is too large to open: %2").arg(filepath, e.what());
+            read                = false;
+        }
+    }
+
+    if (watchdog.expired())
+    {
+        reportTimeout(result, filepath, limits.timeoutMs);
+        return result;
+    }
+    if (!read)
+        return result;
+
+    result.image   = magickImageToQImage(image);
+    result.decoder = "magick (scaled down)";
+    return result;
+}
+
+// The first frame of `filepath` only, read by ImageMagick, for files whose
+// header tells neither Qt nor ImageMagick their size and multi-page files
+// beyond the limits. The size is checked against limits.maxBytes before the
+// frame becomes a QImage; a larger one is scaled down to fit first.
+DecodeResult
+ImageDecoder::decodeFirstFrame(const QString &filepath, const DecodeLimits &limits) noexcept
+{
+    IV_TRACE_SCOPE_DETAIL("ImageDecoder::decodeFirstFrame", filepath);
+
+    initialize();
+
+    DecodeResult result;
+    Magick::Image image;
+    Watchdog watchdog(limits.timeoutMs);
+    watchdog.attach(image);
+    image.subImage(0);
+    image.subRange(1);
+
+    bool read = readMagick(image, filepath, result);
+    const QSize size(int(std::min<size_t>(image.columns(), INT_MAX)), int(std::min<size_t>(image.rows(), INT_MAX)));
+    if (read && limits.maxBytes > 0 && decodedBytes(size) > limits.maxBytes)
+    {
+        const QSize target = fittingSize(size, limits.maxBytes);
+        result.fullSize    = size;
+        try
+        {
+            IV_TRACE_SCOPE("Magick::Image::scale");
+            image.scale(Magick::Geometry(target.width(), target.height()));
+        }
+        catch (const std::exception &e)
+        {
+            qDebug() << "Cannot scale down" << filepath << ":" << e.what();
+            result.errorTitle   = "Open File";
+            result.errorMessage = QString("%1 is too large to open: %2").arg(filepath, e.what());
+            read                = false;
+        }
+    }
+
+    if (watchdog.expired())
+    {
+        reportTimeout(result, filepath, limits.timeoutMs);
+        return result;
+    }
+    if (!read)
+        return result;
+
+    result.image   = magickImageToQImage(image);
+    result.decoder = result.fullSize.isValid() ? "magick (first frame, scaled down)" : "magick (first frame only)";
+    return result;
+}
+
+// image.read() with its failures turned into `result`
+bool
+ImageDecoder::readMagick(Magick::Image &image, const QString &filepath, DecodeResult &result) noexcept
+{
+    try
+    {
+        IV_TRACE_SCOPE("Magick::Image::read");
+        image.read(filepath.toStdString());
+    }
+    catch (const Magick::ErrorFileOpen &e)
+    {
+        qDebug() << "Error opening image: " << e.what();
+        return false;
+    }
+    catch (const Magick::ErrorCorruptImage &e)
+    {
+        qDebug() << "Error corrupt image: " << e.what();
+        return false;
+    }
+    catch (const Magick::ErrorMissingDelegate &e)
+    {
+        qDebug() << "Error missing delegate: " << e.what();
+        result.errorTitle   = "Error missing delegate: ";
+        result.errorMessage = e.what();
+        return false;
+    }
+    catch (const Magick::Exception &e)
+    {
+        qDebug() << "Magick++ exception: " << e.what();
+        result.errorTitle   = "Magick++ exception: ";
+        result.errorMessage = e.what();
+        return false;
+    }
+    catch (const std::exception &e)
+    {
+        qDebug() << "Standard exception: " << e.what();
+        result.errorTitle   = "Standard exception: ";
+        result.errorMessage = e.what();
+        return false;
+    }
+    catch (...)
+    {
+        qDebug() << "Unknown error occurred while opening image.";
+        result.errorTitle   = "Unknown error";
+        result.errorMessage = "An unknown error occurred while opening the image.";
+        return false;
+    }
+    return true;
+}
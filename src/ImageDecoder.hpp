@@ -0,0 +1,89 @@
+#pragma once
+
+#include <ImageMagick-7/Magick++.h>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+// How long a backend took on a file, see DecoderSelector
+struct DecodeTiming
+{
+    QString format;     // e.g. "png"
+    qint64 pixels{-1};  // declared size, -1 when unknown
+    QString backend;    // empty when nothing was measured
+    qint64 ns{0};
+};
+
+// Outcome of decoding a still image
+struct DecodeResult
+{
+    QImage image;           // normalized, see PixelOps::normalize()
+    bool animated{false};   // the file should be played back as an animation instead
+    QString errorTitle;     // set when a failure should be reported to the user
+    QString errorMessage;
+    QSize fullSize;         // declared size of a file too large to decode at full size, `image` is smaller
+    QString decoder;        // backend that decoded `image` and why it was chosen
+    DecodeTiming timing;
+
+    inline bool ok() const noexcept
+    {
+        return animated || !image.isNull();
+    }
+};
+
+// What a file may take once decoded. A file is probed before any pixels are
+// allocated: stills beyond maxBytes are decoded downscaled to fit, animations
+// beyond maxFrames or maxBytes (all frames) show their first frame only.
+struct DecodeLimits
+{
+    qint64 maxBytes{1024ll * 1024 * 1024}; // 0 = no limit
+    int maxFrames{1000};                   // 0 = no limit
+    int timeoutMs{30 * 1000};              // ImageMagick decodes are stopped after this long, 0 = never
+};
+
+// Dimensions and frame count a file declares in its header
+struct ImageProbe
+{
+    QSize size;
+    int frames{1};
+};
+
+// Decoding of still images, independent of any widget so that it can run on
+// a worker thread (and in tools that have no window at all)
+class ImageDecoder
+{
+public:
+    // Initialize ImageMagick once per process. Safe from any thread; callers
+    // that arrive while another thread initializes wait for it. decode() does
+    // this itself, so startup can run it early on a worker.
+    static void initialize() noexcept;
+    static bool initialized() noexcept;
+
+    // Limits for decodes started from now on, in any thread
+    static void setLimits(const DecodeLimits &limits) noexcept;
+    static DecodeLimits limits() noexcept;
+
+    // Read the header of `filepath` only. False when its size cannot be told
+    // without decoding.
+    static bool probe(const QString &filepath, ImageProbe &info) noexcept;
+
+    // An empty `mimeType` is looked up from the contents of the file
+    static DecodeResult decode(const QString &filepath, const QString &mimeType) noexcept;
+    static QImage magickImageToQImage(Magick::Image &image) noexcept;
+
+    // Every frame of an animation, normalized, with its delay in milliseconds
+    static QVector<QImage> decodeFrames(const QString &filepath, QVector<int> &delays) noexcept;
+
+#ifdef HAS_LIBAVIF
+    static QImage avifToQImage(const QString &filepath, QString *error = nullptr) noexcept;
+#endif
+
+private:
+    static DecodeResult decodeDownscaled(const QString &filepath, const QSize &size,
+                                         const DecodeLimits &limits) noexcept;
+    static DecodeResult decodeFirstFrame(const QString &filepath, const DecodeLimits &limits) noexcept;
+    static bool readMagick(Magick::Image &image, const QString &filepath, DecodeResult &result) noexcept;
+    static void decodeWith(const QString &backend, const QString &filepath, const DecodeLimits &limits,
+                           DecodeResult &result) noexcept;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QDateTime>
+#include <QImage>
+#include <QPointF>
+#include <QSize>
+#include <QString>
+#include <QTransform>
+
+// An open image as plain data. A window has a single ImageView that shows the
+// current tab's document; when another tab becomes current the view hands its
+// state back (ImageView::document()) and takes on the next document
+// (ImageView::setDocument()).
+struct ImageDocument
+{
+    enum class FitMode
+    {
+        WINDOW = 0,
+        WIDTH,
+        HEIGHT
+    };
+
+    QString filepath;
+    QDateTime modified;
+
+    // Decoded pixels of a still image. Null until the document has been shown
+    // once, and again after MemoryGovernor evicted it; it is then decoded anew.
+    QImage image;
+    // What MemoryGovernor keeps of an evicted image: a small copy, shown
+    // stretched to `previewSize` (the size of `image`) until the decode lands
+    QImage preview;
+    QSize previewSize;
+    QSize fullSize;  // see DecodeResult::fullSize
+    QString decoder; // see DecodeResult::decoder
+    bool animated{false};
+
+    bool autoReload{false};
+    bool autoFit{false};
+    FitMode fitMode{FitMode::WINDOW};
+
+    // How the image was last shown; only meaningful with hasViewState
+    bool hasViewState{false};
+    int rotation{0};
+    QPointF transformOrigin;
+    QTransform itemTransform;
+    QTransform minimapTransform;
+    QTransform viewTransform;
+    QPointF viewCenter;
+
+    inline qint64 bytes() const noexcept
+    {
+        return image.sizeInBytes() + preview.sizeInBytes();
+    }
+};
@@ -0,0 +1,170 @@
+#include "ImageItem.hpp"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QStyleOptionGraphicsItem>
+#include <cmath>
+
+void
+ImageItem::setMipLevels(const QVector<QPixmap> &levels) noexcept
+{
+    m_mip_levels = levels;
+    m_mip_key    = pixmap().cacheKey();
+    update();
+}
+
+void
+ImageItem::clearMipLevels() noexcept
+{
+    m_mip_levels.clear();
+    m_mip_key = 0;
+}
+
+namespace
+{
+
+qint64
+pixmapBytes(const QPixmap &pix) noexcept
+{
+    return qint64(pix.width()) * pix.height() * pix.depth() / 8;
+}
+
+} // namespace
+
+qint64
+ImageItem::mipBytes() const noexcept
+{
+    qint64 total = 0;
+    for (const QPixmap &level : m_mip_levels)
+        total += pixmapBytes(level);
+    return total;
+}
+
+qint64
+ImageItem::restBytes() const noexcept
+{
+    return pixmapBytes(m_rest_image);
+}
+
+void
+ImageItem::replacePixmap(const QPixmap &pix) noexcept
+{
+    const qint64 oldKey = pixmap().cacheKey();
+    setPixmap(pix);
+
+    const qint64 newKey = pixmap().cacheKey();
+    if (m_mip_key == oldKey)
+        m_mip_key = newKey;
+    clearRestImage();
+}
+
+void
+ImageItem::setFastMode(bool enabled) noexcept
+{
+    if (m_fast_mode == enabled)
+        return;
+
+    m_fast_mode = enabled;
+    update();
+}
+
+void
+ImageItem::setRestImage(const QPixmap &image, const QRectF &itemRect, qreal deviceScale) noexcept
+{
+    m_rest_image = image;
+    m_rest_rect  = itemRect;
+    m_rest_scale = deviceScale;
+    m_rest_key   = pixmap().cacheKey();
+    update(itemRect);
+}
+
+void
+ImageItem::clearRestImage() noexcept
+{
+    if (m_rest_image.isNull())
+        return;
+
+    m_rest_image = QPixmap();
+    m_rest_key   = 0;
+    update(m_rest_rect);
+}
+
+// Index of the smallest level that still has at least one texel per device
+// pixel at `scale` (device pixels per source pixel), or -1 for the full pixmap
+int
+ImageItem::mipLevelForScale(qreal scale) const noexcept
+{
+    if (scale >= 1.0 || !hasMipLevels())
+        return -1;
+
+    const qreal needed = scale * pixmap().width();
+    int level          = -1;
+    for (int i = 0; i < m_mip_levels.size(); ++i)
+    {
+        if (m_mip_levels[i].width() < needed)
+            break;
+        level = i;
+    }
+    return level;
+}
+
+bool
+ImageItem::restImageUsable(qreal deviceScale) const noexcept
+{
+    if (m_fast_mode || m_rest_image.isNull() || m_rest_key != pixmap().cacheKey())
+        return false;
+
+    return std::abs(deviceScale - m_rest_scale) <= m_rest_scale * 1e-4;
+}
+
+void
+ImageItem::paintPixmap(QPainter *painter, qreal deviceScale) noexcept
+{
+    const bool smooth = !m_fast_mode && transformationMode() == Qt::SmoothTransformation;
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, smooth);
+
+    // During interaction, settle for up to 2x magnification of a coarser level
+    const qreal sourceScale = deviceScale / pixmap().devicePixelRatio();
+    const int level         = mipLevelForScale(m_fast_mode ? sourceScale * 0.5 : sourceScale);
+
+    if (level < 0)
+    {
+        painter->drawPixmap(offset(), pixmap());
+        return;
+    }
+
+    const QPixmap &pix = m_mip_levels[level];
+    painter->drawPixmap(pixmapRect(), pix, QRectF(pix.rect()));
+}
+
+void
+ImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget * /* widget */)
+{
+    const qreal deviceScale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) *
+                              painter->device()->devicePixelRatio();
+
+    if (!restImageUsable(deviceScale))
+    {
+        paintPixmap(painter, deviceScale);
+        return;
+    }
+
+    // The rest image only covers what was visible when it was rendered; the
+    // pixmap fills in around it, not under it, so translucent pixels are not
+    // composited twice
+    if (!m_rest_rect.contains(option->exposedRect))
+    {
+        QPainterPath around;
+        around.addRect(option->exposedRect);
+        QPainterPath rest;
+        rest.addRect(m_rest_rect);
+
+        painter->save();
+        painter->setClipPath(around.subtracted(rest), Qt::IntersectClip);
+        paintPixmap(painter, deviceScale);
+        painter->restore();
+    }
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter->drawPixmap(m_rest_rect, m_rest_image, QRectF(m_rest_image.rect()));
+}
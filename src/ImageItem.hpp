@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QGraphicsPixmapItem>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+
+// Pixmap item that, when zoomed out, draws from a chain of pre-filtered half
+// resolution levels instead of resampling the full pixmap on every paint.
+//
+// Rendering is two-phase: while the view is being interacted with, it draws
+// with nearest-neighbour sampling from a cheaper level ("fast mode"); at rest
+// it can show a high quality rendering of the visible region that was
+// produced off the GUI thread (the "rest image").
+class ImageItem : public QGraphicsPixmapItem
+{
+public:
+    ImageItem(QGraphicsItem *parent = nullptr) : QGraphicsPixmapItem(parent)
+    {
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    }
+
+    // Levels must be successive halvings of the current pixmap, largest first
+    void setMipLevels(const QVector<QPixmap> &levels) noexcept;
+    void clearMipLevels() noexcept;
+
+    // Swap in a pixmap with the same pixels (e.g. a new device pixel ratio)
+    // while keeping the mip levels and source image derived from the old one
+    void replacePixmap(const QPixmap &pix) noexcept;
+
+    inline bool hasMipLevels() const noexcept
+    {
+        return !m_mip_levels.isEmpty() && m_mip_key == pixmap().cacheKey();
+    }
+
+    // Memory held for rendering besides the pixmap itself
+    qint64 mipBytes() const noexcept;
+    qint64 restBytes() const noexcept;
+
+    void setFastMode(bool enabled) noexcept;
+
+    inline bool fastMode() const noexcept
+    {
+        return m_fast_mode;
+    }
+
+    // `image` covers `itemRect` (item coordinates) and was rendered for the
+    // given device scale (device pixels per item unit)
+    void setRestImage(const QPixmap &image, const QRectF &itemRect, qreal deviceScale) noexcept;
+    void clearRestImage() noexcept;
+
+    inline QRectF pixmapRect() const noexcept
+    {
+        return QRectF(offset(), pixmap().deviceIndependentSize());
+    }
+
+protected:
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    int mipLevelForScale(qreal scale) const noexcept;
+    bool restImageUsable(qreal deviceScale) const noexcept;
+    void paintPixmap(QPainter *painter, qreal deviceScale) noexcept;
+
+    QVector<QPixmap> m_mip_levels;
+    qint64 m_mip_key{0};
+
+    bool m_fast_mode{false};
+
+    QPixmap m_rest_image;
+    QRectF m_rest_rect;
+    qreal m_rest_scale{0};
+    qint64 m_rest_key{0};
+};
@@ -0,0 +1,163 @@
+#include "ImageMimeData.hpp"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QPainter>
+#include <atomic>
+
+namespace
+{
+
+const QString qtImageMime = QStringLiteral("application/x-qt-image");
+const QString pngMime     = QStringLiteral("image/png");
+const QString jpegMime    = QStringLiteral("image/jpeg");
+
+// formats() is asked for often; the source file is looked at this often at most
+constexpr int SOURCE_CHECK_MS = 1000;
+
+std::atomic<quint64> nextId{1};
+
+QByteArray
+encodeImage(const QImage &image, const QByteArray &format) noexcept
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+
+    // JPEG has no alpha; composite onto white rather than let the transparent
+    // parts come out black
+    QImage flat = image;
+    if (format == "jpeg" && image.hasAlphaChannel())
+    {
+        flat = QImage(image.size(), QImage::Format_RGB32);
+        flat.fill(Qt::white);
+        QPainter painter(&flat);
+        painter.drawImage(0, 0, image);
+    }
+
+    QImageWriter writer(&buffer, format);
+    if (!writer.write(flat))
+    {
+        qWarning() << "Failed to encode clipboard image as" << format << ":" << writer.errorString();
+        return {};
+    }
+
+    return bytes;
+}
+
+} // namespace
+
+ImageMimeData::ImageMimeData(const QImage &image) noexcept : m_id(nextId++), m_image(image)
+{
+}
+
+ImageMimeData::~ImageMimeData() noexcept
+{
+    for (const Encode &encode : std::as_const(m_encoded))
+        encode.token.cancel();
+}
+
+void
+ImageMimeData::setSourceFile(const QString &path, const QString &mimeType, const QDateTime &modified) noexcept
+{
+    m_source_path     = path;
+    m_source_mime     = mimeType;
+    m_source_modified = modified;
+    m_source_checked.invalidate();
+}
+
+QStringList
+ImageMimeData::formats() const
+{
+    QStringList list{ qtImageMime, pngMime, jpegMime };
+
+    if (!m_source_mime.isEmpty() && !list.contains(m_source_mime) && sourceRecentlyUnchanged())
+        list.prepend(m_source_mime);
+
+    return list;
+}
+
+bool
+ImageMimeData::hasFormat(const QString &mimeType) const
+{
+    return formats().contains(mimeType);
+}
+
+bool
+ImageMimeData::sourceUnchanged() const noexcept
+{
+    if (m_source_path.isEmpty())
+        return false;
+
+    const QFileInfo info(m_source_path);
+    m_source_unchanged = info.exists() && info.lastModified() == m_source_modified;
+    m_source_checked.start();
+    return m_source_unchanged;
+}
+
+bool
+ImageMimeData::sourceRecentlyUnchanged() const noexcept
+{
+    if (m_source_checked.isValid() && !m_source_checked.hasExpired(SOURCE_CHECK_MS))
+        return m_source_unchanged;
+    return sourceUnchanged();
+}
+
+// A paste is waiting for it, so it runs in the visible class
+ImageMimeData::Encode &
+ImageMimeData::startEncode(const QString &mimeType) const noexcept
+{
+    const QImage image      = m_image;
+    const QByteArray format = mimeType == jpegMime ? QByteArray("jpeg") : mimeType.section('/', 1).toLatin1();
+    const QString key       = QString("clipboard-%1-%2").arg(m_id).arg(mimeType);
+
+    Encode encode;
+    encode.done   = std::make_shared<QSemaphore>();
+    encode.future = DecodeScheduler::instance().run(
+        DecodeScheduler::Priority::Visible, [image, format, done = encode.done]()
+        {
+            const QByteArray bytes = encodeImage(image, format);
+            done->release();
+            return bytes;
+        },
+        key, encode.token);
+    return *m_encoded.insert(mimeType, encode);
+}
+
+QByteArray
+ImageMimeData::encoded(const QString &mimeType) const noexcept
+{
+    const auto it       = m_encoded.constFind(mimeType);
+    const Encode encode = it != m_encoded.cend() ? *it : startEncode(mimeType);
+
+    if (!encode.done->tryAcquire(1, ENCODE_WAIT_MS))
+    {
+        qWarning() << "Clipboard image not encoded as" << mimeType << "within" << ENCODE_WAIT_MS << "ms";
+        return {};
+    }
+    encode.done->release();
+    return encode.future.result();
+}
+
+QVariant
+ImageMimeData::retrieveData(const QString &mimeType, QMetaType type) const
+{
+    if (mimeType == qtImageMime)
+        return m_image;
+
+    // Pass the original file through untouched
+    if (mimeType == m_source_mime && sourceUnchanged())
+    {
+        QFile file(m_source_path);
+        if (file.open(QIODevice::ReadOnly))
+            return file.readAll();
+    }
+
+    if (mimeType == pngMime || mimeType == jpegMime)
+        return encoded(mimeType);
+
+    return QMimeData::retrieveData(mimeType, type);
+}
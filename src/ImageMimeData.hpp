@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QMimeData>
+#include <QSemaphore>
+#include <memory>
+
+#include "DecodeScheduler.hpp"
+
+// Clipboard payload for an image. A format is encoded on a worker the first
+// time a consumer asks for it, and only once. Qt asks for the data
+// synchronously and has no way to answer later, so the paste waits for the
+// encode, at most ENCODE_WAIT_MS; past that it gets nothing and the encode
+// finishes for the next paste. When the image is an unmodified copy of a file
+// on disk, the file's own bytes are handed out instead of being re-encoded.
+class ImageMimeData : public QMimeData
+{
+public:
+    explicit ImageMimeData(const QImage &image) noexcept;
+    ~ImageMimeData() noexcept;
+
+    // Offer the bytes of `path` for its own type (and PNG/JPEG requests when it
+    // is one of those), as long as the file is still at `modified`
+    void setSourceFile(const QString &path, const QString &mimeType, const QDateTime &modified) noexcept;
+
+    QStringList formats() const override;
+    bool hasFormat(const QString &mimeType) const override;
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QMetaType type) const override;
+
+private:
+    static constexpr int ENCODE_WAIT_MS = 3000;
+
+    struct Encode
+    {
+        QFuture<QByteArray> future;
+        CancelToken token;
+        std::shared_ptr<QSemaphore> done; // released once when the bytes are there
+    };
+
+    bool sourceUnchanged() const noexcept;
+    bool sourceRecentlyUnchanged() const noexcept;
+    Encode &startEncode(const QString &mimeType) const noexcept;
+    QByteArray encoded(const QString &mimeType) const noexcept;
+
+    const quint64 m_id; // keys the encodes on the scheduler; addresses get reused
+    QImage m_image;
+    QString m_source_path, m_source_mime;
+    QDateTime m_source_modified;
+    mutable bool m_source_unchanged{false};
+    mutable QElapsedTimer m_source_checked; // when m_source_unchanged was last found
+    mutable QHash<QString, Encode> m_encoded;
+};
@@ -1,7 +1,10 @@
 #include "ImageView.hpp"
 
+#include "DecodeScheduler.hpp"
 #include "GraphicsView.hpp"
-#include "Magick++/Exception.h"
+#include "PixelOps.hpp"
+#include "RenderPipeline.hpp"
+#include "Trace.hpp"
 
 #include <QEvent>
 #include <QFileInfo>
@@ -9,18 +12,14 @@
 #include <QMessageBox>
 #include <QMimeDatabase>
 #include <QScrollBar>
+#include <QStyleOptionGraphicsItem>
 #include <QThreadPool>
 #include <QtConcurrent/QtConcurrent>
 #include <QtConcurrent/qtconcurrentreducekernel.h>
 #include <qbytearrayview.h>
 #include <qimagereader.h>
 #include <qnamespace.h>
-#include <fstream>
-
-#ifdef HAS_LIBAVIF
-#include <avif/avif.h>
-#endif
-
+#include <cmath>
 
 #ifdef HAS_LIBEXIV2
 #include <exiv2/exiv2.hpp>
@@ -32,7 +31,7 @@ ImageView::ImageView(const Config &config, QWidget *parent) : QWidget(parent), m
     QVBoxLayout *layout = new QVBoxLayout();
     m_gview             = new GraphicsView();
     m_gscene            = new QGraphicsScene();
-    m_pix_item          = new QGraphicsPixmapItem();
+    m_pix_item          = new ImageItem();
 
     m_pix_item->setTransformationMode(Qt::SmoothTransformation);
 
@@ -57,6 +56,10 @@ ImageView::ImageView(const Config &config, QWidget *parent) : QWidget(parent), m
     m_hscrollbar = m_gview->horizontalScrollBar();
     m_vscrollbar = m_gview->verticalScrollBar();
 
+    m_rest_render_timer = new QTimer(this);
+    m_rest_render_timer->setSingleShot(true);
+    m_rest_render_timer->setInterval(100);
+
     UpdateFromConfig();
     initConnections();
 }
@@ -66,287 +69,301 @@ ImageView::initConnections() noexcept
 {
 
     // Minimap click to move viewport
-    connect(m_minimap, &Minimap::minimapClicked, this, [this](const QPointF &pos)
-    {
-        m_gview->centerOn(pos);
-        updateMinimapRegion();
-    });
+    connect(m_minimap, &Minimap::minimapClicked, this, [this](const QPointF &pos) { m_gview->centerOn(pos); });
 
     connect(m_gview, &GraphicsView::zoomInRequested, this, &ImageView::zoomIn);
     connect(m_gview, &GraphicsView::zoomOutRequested, this, &ImageView::zoomOut);
     connect(m_gview, &GraphicsView::zoomResetRequested, this, &ImageView::zoomReset);
+    connect(m_gview, &GraphicsView::openFilesRequested, this, &ImageView::openFilesRequested);
 
     // Overlay moved handler
     connect(m_overlay_rect, &OverlayRect::overlayMoved, this, [this]()
     {
         const QRectF overlayRect    = m_overlay_rect->boundingRect(); // overlay in scene coords
         const QPointF overlayCenter = m_overlay_rect->mapToScene(overlayRect.center());
+        m_gview->beginInteraction();
         m_gview->centerOn(overlayCenter);
-        updateMinimapRegion();
     });
 
-    connect(m_hscrollbar, &QScrollBar::valueChanged, this, &ImageView::updateMinimapRegion);
-    connect(m_vscrollbar, &QScrollBar::valueChanged, this, &ImageView::updateMinimapRegion);
+    // Single, frame-coalesced source of truth for everything that tracks the viewport
+    connect(m_gview, &GraphicsView::viewportChanged, this, &ImageView::updateMinimapRegion);
+    connect(m_gview, &GraphicsView::viewportChanged, this, &ImageView::viewportChanged);
+
+    // Two-phase rendering: cheap while the user is interacting, and a high
+    // quality rendering of the visible region once things settle
+    connect(m_gview, &GraphicsView::interactionStarted, this, [this]() { m_pix_item->setFastMode(true); });
+    connect(m_gview, &GraphicsView::interactionFinished, this, [this]()
+    {
+        m_pix_item->setFastMode(false);
+        m_rest_render_timer->start();
+    });
+    connect(m_gview, &GraphicsView::viewportChanged, this, [this]()
+    {
+        if (!m_gview->isInteracting())
+            m_rest_render_timer->start();
+    });
+    connect(m_rest_render_timer, &QTimer::timeout, this, &ImageView::renderVisibleRegion);
 }
 
 bool
 ImageView::openFile(const QString &filepath) noexcept
 {
+    IV_TRACE_SCOPE_DETAIL("ImageView::openFile", filepath);
+
     if (!QFile::exists(filepath))
         return false;
 
-    m_filepath       = filepath;
-    const auto bytes = QFileInfo(m_filepath).size();
-    m_filesize       = humanReadableSize(bytes);
-    m_mimeType       = getMimeType(filepath);
+    setFile(filepath);
 
     QImageReader reader(filepath);
     m_isGif = reader.supportsAnimation();
 
+    stopGifAnimation();
+
     if (m_isGif)
     {
-        stopGifAnimation();
+        m_image = QImage();
         renderAnimatedImage();
         m_success = true;
-
-        if (m_success)
-        {
-            m_gview->fitInView(m_pix_item, Qt::KeepAspectRatio);
-        }
-    }
-    else
-    {
-        stopGifAnimation();
-
-        m_success = render();
-
-        if (m_success)
-            m_gview->fitInView(m_pix_item, Qt::KeepAspectRatio);
-
+        restoreViewState();
+        emit imageLoaded();
         return m_success;
-
-        // Load static image asynchronously without blocking
-        // QFuture<bool> future = QtConcurrent::run([this, filepath]() { return render(); });
-        //
-        // QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
-        //
-        // connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher]()
-        // {
-        //     m_success = watcher->result();
-        //     if (m_success)
-        //     {
-        //         m_gview->fitInView(m_pix_item, Qt::KeepAspectRatio);
-        //     }
-        //     watcher->deleteLater();
-        // });
-        //
-        // watcher->setFuture(future);
-        // return true; // Return immediately for async loading
     }
 
-    return m_success;
+    // The result is reported through imageLoaded() or openFailed()
+    return render(false);
 }
 
-QImage
-ImageView::magickImageToQImage(Magick::Image &image) noexcept
+void
+ImageView::setFile(const QString &filepath) noexcept
 {
-    const int &width  = image.columns();
-    const int &height = image.rows();
-
-    const bool &hasAlpha           = image.alpha();
-    const std::string format       = hasAlpha ? "RGBA" : "RGB";
-    const QImage::Format imgFormat = hasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888;
+    m_filepath       = filepath;
+    const auto bytes = QFileInfo(m_filepath).size();
+    m_filesize       = humanReadableSize(bytes);
+    m_file_modified  = QFileInfo(m_filepath).lastModified();
+    m_mimeType       = getMimeType(filepath);
+}
 
-    const int bytesPerPixel = hasAlpha ? 4 : 3;
-    const int bytesPerLine  = width * bytesPerPixel; // tightly packed
+// Show `doc`, either from its decoded pixels or by decoding the file again
+void
+ImageView::setDocument(const ImageDocument &doc) noexcept
+{
+    clear();
 
-    std::vector<unsigned char> buffer(width * height * bytesPerPixel);
+    m_auto_fit = doc.autoFit;
+    m_fit_mode = doc.fitMode;
+    m_restore  = doc;
 
-    try
+    const bool decoded = !doc.image.isNull() && !doc.animated;
+    if (decoded && QFileInfo(doc.filepath).lastModified() == doc.modified)
     {
-        image.write(0, 0, width, height, format, Magick::CharPixel, buffer.data());
+        setFile(doc.filepath);
+        m_full_size = doc.fullSize;
+        m_decoder   = doc.decoder;
+        loadImage(doc.image);
+        m_success = true;
+        restoreViewState();
+        emit imageLoaded();
     }
-    catch (...)
+    else
     {
-        return QImage();
+        if (!doc.preview.isNull() && !doc.animated && QFileInfo(doc.filepath).lastModified() == doc.modified)
+            showPreview(doc);
+        if (!openFile(doc.filepath))
+            emit openFailed(doc.filepath);
     }
 
-    // Must copy the image data, as the buffer will go out of scope
-    return QImage(buffer.data(), width, height, bytesPerLine, imgFormat).copy();
+    setAutoReload(doc.autoReload);
 }
 
-#ifdef HAS_LIBAVIF
-QImage
-ImageView::avifToQImage() noexcept
-{
-    QImage img;
-    int width, height;
-    std::vector<uint8_t> pixels;
-    std::string filename = m_filepath.toStdString();
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file)
-    {
-        QMessageBox::critical(this, "Open File", "Failed to open file");
-        qCritical() << "Failed to open file";
-        return img;
-    }
-
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    std::vector<uint8_t> buffer(size);
-    if (!file.read(reinterpret_cast<char *>(buffer.data()), size))
-    {
-        QMessageBox::critical(this, "Open File", "Failed to read file");
-        qCritical() << "Failed to read file\n";
-        return img;
-    }
-
-    // Set up decoder
-    avifDecoder *decoder = avifDecoderCreate();
-    avifResult result    = avifDecoderSetIOMemory(decoder, buffer.data(), buffer.size());
-    if (result != AVIF_RESULT_OK)
-    {
-        const char *err = avifResultToString(result);
-        qCritical() << "Failed to set AVIF IO: " << err << "\n";
-        QMessageBox::critical(this, "Open File", err);
-        avifDecoderDestroy(decoder);
-        return img;
-    }
+// State to hand back to the document when another one is shown
+ImageDocument
+ImageView::document() const noexcept
+{
+    // Still decoding: nothing new to report beyond the settings
+    ImageDocument doc = m_success ? ImageDocument() : m_restore;
 
-    result = avifDecoderParse(decoder);
-    if (result != AVIF_RESULT_OK)
-    {
-        const char *err = avifResultToString(result);
-        qCritical() << "Failed to parse AVIF: " << err << "\n";
-        QMessageBox::critical(this, "Open File", err);
-        avifDecoderDestroy(decoder);
-        return img;
-    }
+    doc.filepath   = m_filepath;
+    doc.autoReload = m_auto_reload;
+    doc.autoFit    = m_auto_fit;
+    doc.fitMode    = m_fit_mode;
+    if (!m_success)
+        return doc;
+
+    doc.modified         = m_file_modified;
+    doc.image            = m_image;
+    doc.fullSize         = m_full_size;
+    doc.decoder          = m_decoder;
+    doc.animated         = m_isGif;
+    doc.hasViewState     = true;
+    doc.rotation         = m_rotation;
+    doc.transformOrigin  = m_pix_item->transformOriginPoint();
+    doc.itemTransform    = m_pix_item->transform();
+    doc.minimapTransform = m_minimap->transform();
+    doc.viewTransform    = m_gview->transform();
+    doc.viewCenter       = m_gview->mapToScene(m_gview->viewport()->rect().center());
+    return doc;
+}
+
+// Back to an empty view, cancelling any work in flight
+void
+ImageView::clear() noexcept
+{
+    stopGifAnimation();
+    if (m_auto_reload)
+        setAutoReload(false);
+
+    ++m_decode_generation;
+    ++m_mip_generation;
+    ++m_rest_generation;
+    m_mip_token.cancel();
+    m_rest_token.cancel();
+    m_frames_token.cancel();
+
+    m_restore         = ImageDocument();
+    m_isGif           = false;
+    m_success         = false;
+    m_showing_preview = false;
+    m_image           = QImage();
+    m_full_size       = QSize();
+    m_decoder.clear();
+    m_filepath.clear();
+    m_filesize.clear();
+    m_mimeType.clear();
+    m_file_modified = QDateTime();
+    m_rotation      = 0;
+
+    m_pix_item->clearMipLevels();
+    m_pix_item->setPixmap(QPixmap());
+    m_pix_item->clearRestImage();
+    m_pix_item->setTransformOriginPoint(QPointF());
+    m_pix_item->setTransform(QTransform());
+    m_minimap->setPixmap(QPixmap());
+    m_minimap->setTransform(QTransform());
+    m_minimap->setRotation(0);
+    m_gview->resetTransform();
+}
+
+// Apply the view state of the document being shown, or fit a fresh one
+void
+ImageView::restoreViewState() noexcept
+{
+    IV_TRACE_SCOPE("ImageView::restoreViewState");
 
-    result = avifDecoderNextImage(decoder);
-    if (result != AVIF_RESULT_OK)
+    if (!m_restore.hasViewState)
     {
-        const char *err = avifResultToString(result);
-        qCritical() << "Failed to decode AVIF image: " << err << "\n";
-        avifDecoderDestroy(decoder);
-        return img;
+        m_gview->fitInView(m_pix_item, Qt::KeepAspectRatio);
+        return;
     }
 
-    avifRGBImage rgb;
-    avifRGBImageSetDefaults(&rgb, decoder->image);
-    rgb.format = AVIF_RGB_FORMAT_RGBA;
-
-    avifResult resalloc = avifRGBImageAllocatePixels(&rgb);
-    avifResult resconv  = avifImageYUVToRGB(decoder->image, &rgb);
-
-    width  = rgb.width;
-    height = rgb.height;
-    pixels.assign(rgb.pixels, rgb.pixels + rgb.rowBytes * height);
-
-    avifRGBImageFreePixels(&rgb);
-    avifDecoderDestroy(decoder);
-
-    return QImage(pixels.data(), width, height, QImage::Format_RGBA8888).copy();
+    m_rotation = m_restore.rotation;
+    m_pix_item->setTransformOriginPoint(m_restore.transformOrigin);
+    m_pix_item->setTransform(m_restore.itemTransform);
+    m_minimap->setTransform(m_restore.minimapTransform);
+    m_minimap->setRotation(m_rotation);
+    m_gview->setSceneRect(m_pix_item->sceneBoundingRect());
+    m_gview->setTransform(m_restore.viewTransform);
+    m_gview->centerOn(m_restore.viewCenter);
 }
 
+// Decode the current file on a worker. The decoder hands back an image that is
+// already in the raster engine's native format, so the GUI thread only uploads
+// it.
 bool
-ImageView::renderAvif() noexcept
+ImageView::render(bool reload) noexcept
 {
-    QImage img = avifToQImage();
-    if (img.isNull())
-        return false;
-    loadImage(img);
-    return true;
-}
-#endif
+    IV_TRACE_SCOPE("ImageView::render");
 
-bool
-ImageView::render() noexcept
-{
+#ifndef HAS_LIBAVIF
     if (m_mimeType == "image/avif")
     {
-#ifdef HAS_LIBAVIF
-        return renderAvif();
-#else
         QMessageBox::warning(this, "Open File",
                              "You have tried to open an AVIF file. IV currently does not open AVIF. Please install "
                              "`libavif` library and then build IV again.");
         return false;
-#endif
     }
+#endif
 
-    Magick::Image image;
-    try
-    {
-        image.read(m_filepath.toStdString());
-    }
-    catch (const Magick::ErrorFileOpen &e)
-    {
-        qDebug() << "Error opening image: " << e.what();
-        // QMessageBox::critical(this, "Error opening image: ", e.what());
-        return false;
-    }
-    catch (const Magick::ErrorCorruptImage &e)
-    {
-        qDebug() << "Error corrupt image: " << e.what();
-        // QMessageBox::critical(this, "Error corrupt image: ", e.what());
-        return false;
-    }
-    catch (const Magick::ErrorMissingDelegate &e)
-    {
-        qDebug() << "Error missing delegate: " << e.what();
-        QMessageBox::critical(this, "Error missing delegate: ", e.what());
-        return false;
-    }
-    catch (const Magick::Exception &e)
-    {
-        qDebug() << "Magick++ exception: " << e.what();
-        QMessageBox::critical(this, "Magick++ exception: ", e.what());
-        return false;
-    }
-    catch (const std::exception &e)
+    const quint64 generation = ++m_decode_generation;
+    const QString filepath   = m_filepath;
+    const QString mimeType   = m_mimeType;
+
+    auto *watcher = new QFutureWatcher<DecodeResult>(this);
+    connect(watcher, &QFutureWatcher<DecodeResult>::finished, this, [this, watcher, generation, reload]()
     {
-        qDebug() << "Standard exception: " << e.what();
-        QMessageBox::critical(this, "Standard exception: ", e.what());
-        return false;
-    }
-    catch (...)
+        watcher->deleteLater();
+        if (generation != m_decode_generation)
+            return;
+
+        onDecodeFinished(watcher->result(), reload);
+    });
+
+    // A shared cache may already hold (or be decoding) this file
+    if (m_image_cache)
+        watcher->setFuture(m_image_cache->decode(filepath, mimeType));
+    else
+        watcher->setFuture(DecodeScheduler::instance().run(
+            DecodeScheduler::Priority::Visible,
+            [filepath, mimeType]() { return ImageDecoder::decode(filepath, mimeType); }));
+    return true;
+}
+
+void
+ImageView::onDecodeFinished(const DecodeResult &result, bool reload) noexcept
+{
+    IV_TRACE_SCOPE("ImageView::onDecodeFinished");
+
+    if (!result.errorTitle.isEmpty())
+        QMessageBox::critical(this, result.errorTitle, result.errorMessage);
+
+    m_success = result.ok();
+
+    if (!m_success)
     {
-        qDebug() << "Unknown error occurred while opening image.";
-        QMessageBox::critical(this, "Unknown error", "An unknown error occurred while opening the image.");
-        return false;
+        if (!reload)
+            emit openFailed(m_filepath);
+        else if (!m_auto_reload)
+            QMessageBox::critical(this, "Error opening image", "Failed to open image: " + m_filepath);
+        return;
     }
 
-    if (hasMoreThanOneFrame())
+    m_decoder = result.decoder;
+    if (result.animated)
+    {
+        m_isGif = true;
+        m_image = QImage();
         renderAnimatedImage();
+    }
     else
     {
-        const QImage &img = magickImageToQImage(image);
-        loadImage(img);
+        m_full_size = result.fullSize;
+        loadImage(result.image);
     }
 
-    return true;
+    // A preview already shows the restored view, which may have been moved since
+    if (!reload && !m_showing_preview)
+        restoreViewState();
+    m_showing_preview = false;
+
+    emit imageLoaded();
 }
 
 void
 ImageView::zoomIn() noexcept
 {
     m_gview->zoomIn();
-    updateMinimapRegion();
 }
 
 void
 ImageView::zoomOut() noexcept
 {
     m_gview->zoomOut();
-    updateMinimapRegion();
 }
 
 void
 ImageView::zoomReset() noexcept
 {
     m_gview->zoomReset();
-    updateMinimapRegion();
 }
 
 // Reset flip
@@ -378,7 +395,6 @@ ImageView::setRotation(int angle) noexcept
 
     m_gview->centerOn(viewCenter);
     m_minimap->setRotation(m_rotation);
-    updateMinimapRegion();
 }
 
 void
@@ -475,6 +491,14 @@ ImageView::flipUpDown() noexcept
     m_minimap->setTransform(t);
 }
 
+// Screen pixels per image pixel, i.e. 1.0 means the image is shown 1:1
+qreal
+ImageView::zoomLevel() const noexcept
+{
+    const qreal viewScale = std::sqrt(std::abs(m_gview->transform().determinant()));
+    return viewScale * m_gview->devicePixelRatioF() / m_dpr;
+}
+
 QString
 ImageView::fileName() noexcept
 {
@@ -504,6 +528,8 @@ ImageView::humanReadableSize(qint64 bytes) noexcept
 void
 ImageView::renderAnimatedImage() noexcept
 {
+    IV_TRACE_SCOPE("ImageView::renderAnimatedImage");
+
     const qint64 fileSize  = QFileInfo(m_filepath).size();
     const qint64 threshold = 10 * 1024 * 1024; // 10 MB
 
@@ -539,15 +565,8 @@ ImageView::hideEvent(QHideEvent *e)
     QWidget::hideEvent(e);
 }
 
-bool
-ImageView::hasMoreThanOneFrame() noexcept
-{
-    const QImageReader reader(m_filepath);
-    return reader.supportsAnimation();
-}
-
 void
-ImageView::updateMinimapRegion() noexcept
+ImageView::updateMinimapRegion(const QRectF &viewRect) noexcept
 {
     if (m_minimap->forceHidden())
         return;
@@ -555,9 +574,6 @@ ImageView::updateMinimapRegion() noexcept
     // Full image rect in scene coordinates
     QRectF imageRect = m_pix_item->sceneBoundingRect();
 
-    // Current visible viewport in scene coordinates
-    QRectF viewRect = m_gview->mapToScene(m_gview->viewport()->rect()).boundingRect();
-
     // Clamp viewRect inside imageRect
     QRectF clampedRect = viewRect.intersected(imageRect);
 
@@ -578,8 +594,8 @@ ImageView::updateMinimapRegion() noexcept
     }
 
     // Hide minimap if the entire image fits in the viewport
-    const QPolygonF viewportPoly = m_gview->mapToScene(m_gview->viewport()->rect());
-    bool fullyVisible            = true;
+    const QPolygonF viewportPoly(viewRect);
+    bool fullyVisible = true;
     for (const QPointF &pt : viewportPoly)
     {
         if (imageRect.contains(pt))
@@ -673,7 +689,6 @@ void
 ImageView::resizeEvent(QResizeEvent *e)
 {
     updateMinimapPosition();
-    updateMinimapRegion();
     QWidget::resizeEvent(e);
 }
 
@@ -704,12 +719,66 @@ ImageView::dragEnterEvent(QDragEnterEvent *e)
 QSize
 ImageView::size() noexcept
 {
-    return m_pix_item->pixmap().size();
+    return m_isGif ? m_pix_item->pixmap().size() : m_image.size();
+}
+
+// Animations only exist as frames for display, so they are read back from
+// the player; still images come straight from the decoded buffer
+QImage
+ImageView::image() const noexcept
+{
+    if (!m_isGif)
+        return m_image;
+
+    if (m_movie)
+        return m_movie->currentImage();
+
+    return m_pix_item->pixmap().toImage();
+}
+
+QMap<QString, qint64>
+ImageView::memoryUsage() const noexcept
+{
+    auto bytes = [](const QPixmap &pix) { return qint64(pix.width()) * pix.height() * pix.depth() / 8; };
+
+    QMap<QString, qint64> usage;
+    const QPixmap &pix = m_pix_item->pixmap();
+
+    usage["source"]     = m_image.sizeInBytes();
+    usage["pixmap"]     = bytes(pix);
+    usage["mip_levels"] = m_pix_item->mipBytes();
+    usage["rest_image"] = m_pix_item->restBytes();
+
+    // Usually the same pixmap as the view's, which costs nothing extra
+    const QPixmap minimap = m_minimap->pixmap();
+    usage["minimap"]      = minimap.cacheKey() == pix.cacheKey() ? 0 : bytes(minimap);
+
+    qint64 frames = 0;
+    for (const QPixmap &frame : m_gifFrames)
+        frames += bytes(frame);
+    usage["gif_frames"] = frames;
+
+    // QMovie does not expose its frame cache; assume every frame is cached
+    const int movieFrames = m_movie ? std::max(0, m_movie->frameCount()) : 0;
+    usage["movie_cache"]  = movieFrames ? movieFrames * bytes(m_movie->currentPixmap()) : 0;
+
+    return usage;
+}
+
+qint64
+ImageView::decodedBytes() const noexcept
+{
+    qint64 total = 0;
+    for (const qint64 bytes : memoryUsage())
+        total += bytes;
+    return total;
 }
 
 QString
 ImageView::getMimeType(const QString &filePath) noexcept
 {
+    IV_TRACE_SCOPE("ImageView::getMimeType");
+
     QMimeDatabase db;
     QMimeType type = db.mimeTypeForFile(filePath);
     return type.name();
@@ -718,16 +787,135 @@ ImageView::getMimeType(const QString &filePath) noexcept
 void
 ImageView::loadImage(const QImage &img) noexcept
 {
-    QPixmap pix = QPixmap::fromImage(img);
+    IV_TRACE_SCOPE("ImageView::loadImage");
+
+    m_image = img;
+    QPixmap pix;
+    {
+        IV_TRACE_SCOPE("QPixmap::fromImage");
+        pix = QPixmap::fromImage(img);
+    }
 
     pix.setDevicePixelRatio(m_dpr);
     m_pix_item->setPixmap(pix);
+    m_pix_item->clearRestImage();
     m_minimap->setPixmap(pix);
 
     if (!m_config.ui.minimap_image)
         m_minimap->showOverlayOnly(true);
 
     m_gview->setSceneRect(m_pix_item->boundingRect());
+
+    requestMipChain(img);
+    emit memoryUsageChanged();
+}
+
+// The preview of an evicted document, stretched to the size of the image it
+// stands for so that the view state restored for it carries over once the
+// decode lands
+void
+ImageView::showPreview(const ImageDocument &doc) noexcept
+{
+    IV_TRACE_SCOPE("ImageView::showPreview");
+
+    QPixmap pix = QPixmap::fromImage(doc.preview);
+    pix.setDevicePixelRatio(m_dpr * qreal(doc.preview.width()) / std::max(1, doc.previewSize.width()));
+    m_pix_item->setPixmap(pix);
+    m_minimap->setPixmap(pix);
+    if (!m_config.ui.minimap_image)
+        m_minimap->showOverlayOnly(true);
+
+    m_gview->setSceneRect(m_pix_item->boundingRect());
+    restoreViewState();
+    m_showing_preview = true;
+}
+
+// Build the zoomed-out levels on a worker; they are only used once they arrive
+// and only while the pixmap they were built from is still shown
+void
+ImageView::requestMipChain(const QImage &img) noexcept
+{
+    m_pix_item->clearMipLevels();
+    const quint64 generation = ++m_mip_generation;
+    m_mip_token.cancel();
+    m_mip_token = CancelToken();
+
+    // Small images are cheap enough to resample directly
+    if (std::max(img.width(), img.height()) < 1024)
+        return;
+
+    auto *watcher = new QFutureWatcher<QVector<QImage>>(this);
+    connect(watcher, &QFutureWatcher<QVector<QImage>>::finished, this, [this, watcher, generation]()
+    {
+        watcher->deleteLater();
+        if (generation != m_mip_generation)
+            return;
+
+        QVector<QPixmap> levels;
+        for (const QImage &level : watcher->result())
+            levels.append(QPixmap::fromImage(level));
+        m_pix_item->setMipLevels(levels);
+        emit memoryUsageChanged();
+    });
+
+    // Only makes zooming out look better, the image is already on screen
+    watcher->setFuture(DecodeScheduler::instance().run(DecodeScheduler::Priority::Maintenance, [img]()
+    {
+        IV_TRACE_SCOPE("PixelOps::buildMipChain");
+        return PixelOps::buildMipChain(img);
+    }, QString(), m_mip_token));
+}
+
+// Resample exactly the visible part of the image to the current device scale
+// with a high quality filter on a worker, then swap it in over the mip level
+void
+ImageView::renderVisibleRegion() noexcept
+{
+    const quint64 generation = ++m_rest_generation;
+    const QImage source      = m_image; // null while an animation plays
+    m_rest_token.cancel();
+    m_rest_token = CancelToken();
+    if (source.isNull() || m_gview->isInteracting() || !isVisible())
+        return;
+
+    const QTransform deviceTransform = m_pix_item->deviceTransform(m_gview->viewportTransform());
+    const qreal lod                  = QStyleOptionGraphicsItem::levelOfDetailFromTransform(deviceTransform);
+    const qreal deviceScale          = lod * m_gview->viewport()->devicePixelRatioF();
+
+    const qreal sourceDpr   = m_pix_item->pixmap().devicePixelRatio();
+    const qreal sourceScale = deviceScale / sourceDpr;
+
+    // Zoomed in, smooth sampling of the pixmap is already as good as it gets
+    if (sourceScale >= 1.0)
+    {
+        m_pix_item->clearRestImage();
+        return;
+    }
+
+    const QRectF visible  = m_pix_item->mapFromScene(m_gview->visibleSceneRect()).boundingRect();
+    const QRectF itemRect = visible.intersected(m_pix_item->pixmapRect());
+    const QRect srcRect =
+        QRectF(itemRect.topLeft() * sourceDpr, itemRect.size() * sourceDpr).toAlignedRect().intersected(source.rect());
+    const QSize targetSize = (QSizeF(srcRect.size()) * sourceScale).toSize();
+    if (srcRect.isEmpty() || targetSize.isEmpty())
+        return;
+
+    const QRectF restRect(QPointF(srcRect.topLeft()) / sourceDpr, QSizeF(srcRect.size()) / sourceDpr);
+
+    auto *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, generation, restRect, deviceScale]()
+    {
+        watcher->deleteLater();
+        if (generation != m_rest_generation || m_gview->isInteracting())
+            return;
+        m_pix_item->setRestImage(QPixmap::fromImage(watcher->result()), restRect, deviceScale);
+    });
+
+    watcher->setFuture(DecodeScheduler::instance().run(
+        DecodeScheduler::Priority::Visible,
+        [source, srcRect, targetSize]()
+        { return source.copy(srcRect).scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation); },
+        QString(), m_rest_token));
 }
 
 void
@@ -740,7 +928,7 @@ ImageView::setDPR(float dpr) noexcept
 
     QPixmap pix = m_pix_item->pixmap();
     pix.setDevicePixelRatio(m_dpr);
-    m_pix_item->setPixmap(pix);
+    m_pix_item->replacePixmap(pix);
 }
 
 bool
@@ -751,22 +939,14 @@ ImageView::reloadFile() noexcept
 
     const auto bytes = QFileInfo(m_filepath).size();
     m_filesize       = humanReadableSize(bytes);
+    m_file_modified  = QFileInfo(m_filepath).lastModified();
 
     m_isGif = false;
     stopGifAnimation();
     m_mimeType = getMimeType(m_filepath);
     m_success  = false;
 
-    m_success = render();
-
-    if (!m_success)
-    {
-        if (!m_auto_reload)
-            QMessageBox::critical(this, "Error opening image", "Failed to open image: " + m_filepath);
-        return m_success;
-    }
-
-    return m_success;
+    return render(true);
 }
 
 // Watch for file changes and auto-reload
@@ -902,10 +1082,6 @@ ImageView::UpdateFromConfig() noexcept
     if (!m_config.ui.minimap_image)
         m_minimap->showOverlayOnly(true);
 
-    // Disconnect old connections to avoid duplicates
-    disconnect(m_hscrollbar, &QScrollBar::valueChanged, this, nullptr);
-    disconnect(m_vscrollbar, &QScrollBar::valueChanged, this, nullptr);
-
     if (!m_config.ui.vscrollbar_auto_hide)
         m_gview->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
 
@@ -918,12 +1094,7 @@ ImageView::UpdateFromConfig() noexcept
     if (!m_config.ui.hscrollbar_shown)
         m_gview->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
-    if (m_config.ui.minimap_shown)
-    {
-        connect(m_hscrollbar, &QScrollBar::valueChanged, this, [&](int /*value */) { updateMinimapRegion(); });
-        connect(m_vscrollbar, &QScrollBar::valueChanged, this, [&](int /*value */) { updateMinimapRegion(); });
-        connect(m_gview, &GraphicsView::openFilesRequested, this, &ImageView::openFilesRequested);
-    }
+    updateMinimapRegion(m_gview->visibleSceneRect());
 }
 
 void
@@ -963,7 +1134,13 @@ ImageView::showFilePropertiesDialog() noexcept
 
     PropertiesWidget::Properties properties;
 
-    const QPixmap &pix = m_pix_item->pixmap();
+    const QImage img = image();
+
+    // A downscaled decode shows at less than the file's own size
+    QString dimensions = QString("%1 x %2").arg(img.width()).arg(img.height());
+    if (m_full_size.isValid())
+        dimensions =
+            QString("%1 x %2 (shown at %3)").arg(m_full_size.width()).arg(m_full_size.height()).arg(dimensions);
 
     properties = {
         QPair("Name", fileInfo.fileName()),
@@ -975,8 +1152,10 @@ ImageView::showFilePropertiesDialog() noexcept
         QPair("Readable", fileInfo.isReadable() ? "Yes" : "No"),
         QPair("Writable", fileInfo.isWritable() ? "Yes" : "No"),
         QPair("Hidden", fileInfo.isHidden() ? "Yes" : "No"),
-        QPair("Dimensions", QString("%1 x %2").arg(pix.width()).arg(pix.height())),
-        QPair("DPI", QString("%1 x %2").arg(pix.logicalDpiX()).arg(pix.logicalDpiY())),
+        QPair("Dimensions", dimensions),
+        QPair("Decoder", m_decoder.isEmpty() ? "-" : m_decoder),
+        QPair("DPI",
+              QString("%1 x %2").arg(qRound(img.dotsPerMeterX() * 0.0254)).arg(qRound(img.dotsPerMeterY() * 0.0254))),
     };
 
     m_prop_widget->setProperties(properties);
@@ -1005,6 +1184,8 @@ ImageView::renderWithQMovie() noexcept
         m_movie = nullptr;
     }
 
+    IV_TRACE_SCOPE("ImageView::renderWithQMovie");
+
     m_movie = new QMovie(m_filepath, QByteArray(), this);
     m_movie->setCacheMode(QMovie::CacheAll); // Cache all frames
     m_movie->setSpeed(100);                  // Normal speed
@@ -1032,35 +1213,36 @@ ImageView::renderWithPreDecode() noexcept
     m_gifDelays.clear();
     m_currentFrame = 0;
 
+    m_frames_token.cancel();
+    m_frames_token = CancelToken();
+
     // Pre-decode all frames in background thread
-    QFuture<void> future = QtConcurrent::run([this]()
+    const QString filepath   = m_filepath;
+    const quint64 generation = m_decode_generation;
+    DecodeScheduler::instance().run(DecodeScheduler::Priority::Visible, [this, filepath, generation]()
     {
-        QImageReader reader(m_filepath);
-        QVector<QPixmap> frames;
         QVector<int> delays;
+        QVector<QImage> frames = ImageDecoder::decodeFrames(filepath, delays);
 
-        while (reader.canRead())
+        // Update on main thread, unless another file is shown by now
+        QMetaObject::invokeMethod(
+            this, [this, generation, frames = std::move(frames), delays = std::move(delays)]() mutable
         {
-            QImage image = reader.read();
-            if (image.isNull())
-                break;
-
-            int delay = reader.nextImageDelay();
-            if (delay <= 0)
-                delay = 100; // Default 100ms
-
-            frames.append(QPixmap::fromImage(image));
-            delays.append(delay);
-        }
-
-        // Update on main thread
-        QMetaObject::invokeMethod(this, [this, frames = std::move(frames), delays = std::move(delays)]() mutable
-        {
-            m_gifFrames = std::move(frames);
+            if (generation != m_decode_generation)
+                return;
+
+            // QPixmap may only be created on the GUI thread; the frames are
+            // already in its native format so this is a plain upload
+            IV_TRACE_SCOPE("ImageView::uploadFrames");
+            m_gifFrames.clear();
+            m_gifFrames.reserve(frames.size());
+            for (const QImage &frame : frames)
+                m_gifFrames.append(QPixmap::fromImage(frame));
             m_gifDelays = std::move(delays);
             startGifPlayback();
+            emit memoryUsageChanged();
         }, Qt::QueuedConnection);
-    });
+    }, QString(), m_frames_token);
 }
 
 void
@@ -1207,7 +1389,14 @@ ImageView::transformedImage() const noexcept
     if (!m_pix_item || m_pix_item->pixmap().isNull())
         return {};
 
-    return m_pix_item->pixmap().transformed(m_pix_item->transform()).toImage();
+    // Rotations and flips are plain pixel moves, done on the decoded image
+    // rather than through QPainter's generic affine path
+    PixelOps::Orientation orientation;
+    const QImage source = image();
+    if (PixelOps::orientationFromTransform(m_pix_item->transform(), orientation))
+        return PixelOps::orient(source, orientation);
+
+    return source.transformed(m_pix_item->transform());
 }
 
 QImage
@@ -1216,6 +1405,39 @@ ImageView::viewportImage() const noexcept
     if (!m_pix_item || m_pix_item->pixmap().isNull())
         return {};
 
+    // Crop the visible part straight out of the decoded image instead of
+    // repainting the scene. Only rotations/flips can be replayed on the crop.
+    PixelOps::Orientation orientation;
+    if (!PixelOps::orientationFromTransform(m_pix_item->transform(), orientation))
+        return renderViewport();
+
+    const QImage source = image();
+    if (source.isNull())
+        return {};
+
+    const qreal sourceDpr = m_pix_item->pixmap().devicePixelRatio();
+    const QRectF visible  = m_pix_item->mapFromScene(m_gview->visibleSceneRect()).boundingRect();
+    const QRectF itemRect = visible.intersected(m_pix_item->pixmapRect());
+    const QRect srcRect =
+        QRectF(itemRect.topLeft() * sourceDpr, itemRect.size() * sourceDpr).toAlignedRect().intersected(source.rect());
+    if (srcRect.isEmpty())
+        return {};
+
+    if (m_config.behavior.copy_viewport_native_resolution)
+        return RenderPipeline::cropOrientScale(source, srcRect, orientation, 1.0);
+
+    // Screen resolution: resample unless the image is shown 1:1
+    const QTransform deviceTransform = m_pix_item->deviceTransform(m_gview->viewportTransform());
+    const qreal lod                  = QStyleOptionGraphicsItem::levelOfDetailFromTransform(deviceTransform);
+    const qreal sourceScale          = lod * m_gview->viewport()->devicePixelRatioF() / sourceDpr;
+    return RenderPipeline::cropOrientScale(source, srcRect, orientation, sourceScale);
+}
+
+// What is on screen, including the background, for transforms the crop path
+// cannot reproduce
+QImage
+ImageView::renderViewport() const noexcept
+{
     QRect viewportRect = m_gview->viewport()->rect();
     QImage viewportImage(viewportRect.size(), QImage::Format_ARGB32);
     viewportImage.fill(Qt::transparent);
@@ -2,10 +2,15 @@
 
 #include "Config.hpp"
 #include "GraphicsView.hpp"
+#include "ImageCache.hpp"
+#include "ImageDecoder.hpp"
+#include "ImageDocument.hpp"
+#include "ImageItem.hpp"
 #include "Minimap.hpp"
+#include "PixelOps.hpp"
 #include "PropertiesWidget.hpp"
 
-#include <ImageMagick-7/Magick++.h>
+#include <QDateTime>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QFileInfo>
@@ -29,12 +34,11 @@ public:
     bool reloadFile() noexcept;
     void setDPR(float dpr) noexcept;
 
-    enum class FitMode
-    {
-        WINDOW = 0,
-        WIDTH,
-        HEIGHT
-    };
+    using FitMode = ImageDocument::FitMode;
+
+    void setDocument(const ImageDocument &doc) noexcept;
+    ImageDocument document() const noexcept;
+    void clear() noexcept;
 
     QSize size() noexcept;
     void scrollToLeftEdge() noexcept;
@@ -64,8 +68,9 @@ public:
 
     static inline QPixmap rotatePixmap90(const QPixmap &src)
     {
-        static const QTransform rot90 = QTransform().rotate(90);
-        return src.transformed(rot90, Qt::FastTransformation);
+        QPixmap pix = QPixmap::fromImage(PixelOps::orient(src.toImage(), PixelOps::Orientation::Rotate90));
+        pix.setDevicePixelRatio(src.devicePixelRatio());
+        return pix;
     }
 
     inline void setAutoFit(bool enabled) noexcept
@@ -78,6 +83,12 @@ public:
         return m_auto_fit;
     }
 
+    // Decode through `cache` instead of privately; must outlive the view
+    inline void setImageCache(ImageCache *cache) noexcept
+    {
+        m_image_cache = cache;
+    }
+
     inline void setConfig(const Config &config) noexcept
     {
         m_config = config;
@@ -91,6 +102,23 @@ public:
     {
         return m_filepath;
     }
+    inline QString mimeType() const noexcept
+    {
+        return m_mimeType;
+    }
+
+    // Modification time of the file when it was (re)loaded
+    inline QDateTime fileModified() const noexcept
+    {
+        return m_file_modified;
+    }
+
+    // Whether the image is shown rotated or flipped
+    inline bool isTransformed() const noexcept
+    {
+        return !m_pix_item->transform().isIdentity();
+    }
+
     inline QString fileSize() noexcept
     {
         return m_filesize;
@@ -103,7 +131,7 @@ public:
     inline void toggleMinimap() noexcept
     {
         m_minimap->setForceHidden(!m_minimap->forceHidden());
-        updateMinimapRegion();
+        updateMinimapRegion(m_gview->visibleSceneRect());
     }
 
     inline void setOverlayRectColor(const QColor &color) noexcept
@@ -145,11 +173,16 @@ public:
         return m_minimap;
     }
 
-    inline const QImage image() const noexcept
-    {
-        return m_pix_item->pixmap().toImage();
-    }
+    QImage image() const noexcept;
+
+    // Bytes of decoded pixels held for this view by category: the source
+    // image, the pixmap, render caches and animation frames
+    QMap<QString, qint64> memoryUsage() const noexcept;
+    qint64 decodedBytes() const noexcept;
+
+    static QString humanReadableSize(qint64 bytes) noexcept;
 
+    qreal zoomLevel() const noexcept;
     QImage transformedImage() const noexcept;
     QImage viewportImage() const noexcept;
 
@@ -173,6 +206,10 @@ public:
 
 signals:
     void openFilesRequested(const QList<QString> &files);
+    void imageLoaded();
+    void openFailed(const QString &filepath);
+    void memoryUsageChanged();
+    void viewportChanged(const QRectF &sceneRect);
 
 private slots:
     void updateGifFrame(int frameNumber = 0) noexcept;
@@ -188,18 +225,18 @@ protected:
 private:
     void initConnections() noexcept;
     void loadImage(const QImage &img) noexcept;
-    bool render() noexcept;
+    void showPreview(const ImageDocument &doc) noexcept;
+    void requestMipChain(const QImage &img) noexcept;
+    void renderVisibleRegion() noexcept;
+    QImage renderViewport() const noexcept;
+    void setFile(const QString &filepath) noexcept;
+    void restoreViewState() noexcept;
+    bool render(bool reload) noexcept;
+    void onDecodeFinished(const DecodeResult &result, bool reload) noexcept;
     void setRotation(int angle) noexcept;
 
-#ifdef HAS_LIBAVIF
-    bool renderAvif() noexcept;
-    QImage avifToQImage() noexcept;
-#endif
-
     void renderAnimatedImage() noexcept;
-    QString humanReadableSize(qint64 bytes) noexcept;
-    bool hasMoreThanOneFrame() noexcept;
-    void updateMinimapRegion() noexcept;
+    void updateMinimapRegion(const QRectF &viewRect) noexcept;
     QString getMimeType(const QString &filepath) noexcept;
 
     void renderWithQMovie() noexcept;
@@ -215,12 +252,19 @@ private:
     void tryReloadLater(int attempt) noexcept;
 
     bool m_isGif{false}, m_success{false}, m_auto_reload{false}, m_auto_fit{false};
+    bool m_showing_preview{false}; // of an evicted document, until its decode lands
 
     float m_dpr{1.0f};
-    QImage magickImageToQImage(Magick::Image &image) noexcept;
     GraphicsView *m_gview;
     QGraphicsScene *m_gscene;
-    QGraphicsPixmapItem *m_pix_item{nullptr};
+    ImageItem *m_pix_item{nullptr};
+    ImageCache *m_image_cache{nullptr};
+    quint64 m_decode_generation{0};
+    quint64 m_mip_generation{0};
+    quint64 m_rest_generation{0};
+    // Queued work of a superseded generation is dropped before it starts
+    CancelToken m_mip_token, m_rest_token, m_frames_token;
+    QTimer *m_rest_render_timer{nullptr};
     QString m_filepath, m_filesize;
     float m_zoomFactor{1.25};
     int m_rotation{0};
@@ -230,8 +274,19 @@ private:
     OverlayRect *m_overlay_rect{nullptr};
     Config m_config;
     QString m_mimeType;
+    QDateTime m_file_modified;
+
+    // Decoded pixels of a still image, the source of truth for everything but
+    // drawing; the pixmap is only a display cache of it
+    QImage m_image;
+    QSize m_full_size; // declared size of the file when m_image was decoded downscaled
+    QString m_decoder; // DecodeResult::decoder of m_image
+
     QFileSystemWatcher *m_file_watcher{nullptr};
-    FitMode m_fit_mode;
+    FitMode m_fit_mode{FitMode::WINDOW};
+
+    // Document being shown, kept until its view state has been applied
+    ImageDocument m_restore;
 
     // For pre-decoded playback (small GIFs)
     QVector<QPixmap> m_gifFrames;
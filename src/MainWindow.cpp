@@ -1,25 +1,36 @@
 #include "MainWindow.hpp"
 
 #include "ImageView.hpp"
+#include "DocumentTab.hpp"
+#include "CommandServer.hpp"
+#include "DecoderSelector.hpp"
+#include "SingleInstance.hpp"
+#include "StartupOrchestrator.hpp"
+#include "StartupProfiler.hpp"
 #include "toml.hpp"
 
 #include <QActionGroup>
 #include <QClipboard>
 #include <QDesktopServices>
 #include <QFileDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QKeySequence>
 #include <QMenuBar>
 #include <QMessageBox>
-#include <QProgressDialog>
+#include <QPushButton>
 #include <QScreen>
+#include <QSet>
 #include <QShortcut>
 #include <QTabBar>
 #include <QTimer>
 #include <QWindow>
 
 void
-MainWindow::readArgs(argparse::ArgumentParser &parser) noexcept
+MainWindow::readArgs(argparse::ArgumentParser &parser, StartupOrchestrator *startup) noexcept
 {
+    m_startup = startup;
 
     // Check if version or commands flag is used
     if (parser.is_used("version"))
@@ -51,6 +62,38 @@ MainWindow::readArgs(argparse::ArgumentParser &parser) noexcept
     if (parser.is_used("not-tabbed"))
         m_not_tabbed = true;
 
+    if (parser.is_used("single-instance"))
+        m_single_instance = true;
+
+    if (parser.is_used("daemon"))
+    {
+        m_daemon     = true;
+        m_not_tabbed = false;
+        QApplication::setQuitOnLastWindowClosed(false);
+
+        // Warm everything a window needs without showing one; files given on
+        // the command line are only preloaded
+        QStringList files;
+        if (parser.is_used("files"))
+        {
+            for (const std::string &file : parser.get<std::vector<std::string>>("files"))
+                files.append(QString::fromStdString(file));
+        }
+
+        this->construct(files);
+        for (const QString &file : files)
+            m_image_cache.prefetch(resolveFilePath(file), false);
+
+        initSingleInstance();
+        if (!m_single_instance_server)
+        {
+            qCritical() << "iv: cannot run as a daemon, another instance is already serving";
+            exit(1);
+        }
+        initCommandServer();
+        return;
+    }
+
     if (parser.is_used("files"))
     {
         auto files = parser.get<std::vector<std::string>>("files");
@@ -58,9 +101,16 @@ MainWindow::readArgs(argparse::ArgumentParser &parser) noexcept
             OpenFiles(files);
         else
         {
+            QStringList list;
+            for (const std::string &file : files)
+                list.append(QString::fromStdString(file));
+
             // Construct the main window
-            this->construct();
-            OpenFiles(files);
+            this->construct(list);
+            OpenFiles(list);
+            StartupProfiler::mark("tabs_created");
+            if (m_tab_widget->count() == 0)
+                QTimer::singleShot(0, this, []() { StartupProfiler::finish("no file could be opened"); });
         }
     }
     else
@@ -68,23 +118,195 @@ MainWindow::readArgs(argparse::ArgumentParser &parser) noexcept
         // Construct the main window
         this->construct();
     }
+
+    if (!m_not_tabbed && (m_single_instance || m_config.behavior.single_instance))
+        initSingleInstance();
+    if (m_config.behavior.command_server)
+        initCommandServer();
+}
+
+// Accept files from later invocations, see SingleInstance
+void
+MainWindow::initSingleInstance() noexcept
+{
+    m_single_instance_server = new SingleInstance(this);
+    if (!m_single_instance_server->listen())
+    {
+        m_single_instance_server->deleteLater();
+        m_single_instance_server = nullptr;
+        return;
+    }
+
+    connect(m_single_instance_server, &SingleInstance::filesRequested, this, [this](const QStringList &files)
+    {
+        if (!files.isEmpty())
+            OpenFiles(files);
+
+        if (isMinimized())
+            showNormal();
+        else if (!isVisible())
+            show();
+        raise();
+        activateWindow();
+    });
+
+    connect(m_single_instance_server, &SingleInstance::preloadRequested, this, [this](const QStringList &files)
+    {
+        for (const QString &file : files)
+            m_image_cache.prefetch(resolveFilePath(file), false);
+    });
+}
+
+// Run keybinding commands sent by `iv --command` and scripts, see CommandServer
+void
+MainWindow::initCommandServer() noexcept
+{
+    m_command_server = new CommandServer(
+        [this](const QString &command, const QString &argument, QString &error)
+        { return runCommand(command, argument, error); },
+        this);
+
+    if (!m_command_server->listen())
+    {
+        m_command_server->deleteLater();
+        m_command_server = nullptr;
+    }
+}
+
+// Besides every entry of m_commandMap, scripts can `open PATH`, ask for the
+// `status` of the current tab, list the available `commands` and `quit`, the
+// only way to end a daemon short of a signal. Commands that open a modal
+// dialog are refused: the reply would wait for someone at the screen.
+QJsonValue
+MainWindow::runCommand(const QString &command, const QString &argument, QString &error) noexcept
+{
+    static const QSet<QString> interactiveCommands{"open_file", "file_properties", "memory_usage"};
+
+    if (command == "open")
+    {
+        if (argument.isEmpty())
+        {
+            error = "open needs a file path";
+            return {};
+        }
+        const QString path = resolveFilePath(argument);
+        if (!QFileInfo::exists(path))
+        {
+            error = QString("no such file: %1").arg(path);
+            return {};
+        }
+        OpenFile(path);
+        if (!isVisible())
+            show();
+        return path;
+    }
+
+    if (command == "status")
+    {
+        QJsonObject status{
+            {"tabs", m_tab_widget ? m_tab_widget->count() : 0},
+            {"tab", m_tab_widget ? m_tab_widget->currentIndex() : -1},
+            {"visible", isVisible()},
+        };
+        if (m_current_tab && m_view)
+        {
+            status["file"] = m_view->filePath();
+            status["zoom"] = m_view->zoomLevel();
+        }
+        return status;
+    }
+
+    if (command == "quit")
+    {
+        // After the reply has gone out
+        QTimer::singleShot(0, qApp, &QApplication::quit);
+        return {};
+    }
+
+    if (command == "commands")
+    {
+        QJsonArray names;
+        for (auto it = m_commandMap.cbegin(); it != m_commandMap.cend(); ++it)
+        {
+            if (!interactiveCommands.contains(it.key()))
+                names.append(it.key());
+        }
+        names.append("open");
+        names.append("status");
+        names.append("quit");
+        return names;
+    }
+
+    const auto it = m_commandMap.find(command);
+    if (it == m_commandMap.end())
+    {
+        error = QString("unknown command: %1").arg(command);
+        return {};
+    }
+    if (interactiveCommands.contains(command))
+    {
+        error = QString("%1 opens a dialog and cannot be scripted").arg(command);
+        return {};
+    }
+    if (!argument.isEmpty())
+    {
+        error = QString("%1 takes no argument").arg(command);
+        return {};
+    }
+
+    // Commands that act on the image shown, which a daemon or a window
+    // without tabs does not have
+    static const QSet<QString> viewCommands{
+        "reset_view",      "copy_path",     "copy_dir",      "copy_image",       "copy_viewport",
+        "reload_file",     "left_edge",     "right_edge",    "top_edge",         "bottom_edge",
+        "zoom_in",         "zoom_out",      "zoom_reset",    "rotate_clock",     "rotate_anticlock",
+        "fit_width",       "fit_height",    "fit_window",    "auto_fit",         "file_properties",
+        "scroll_left",     "scroll_down",   "scroll_up",     "scroll_right",     "toggle_minimap",
+        "flip_horizontal", "flip_vertical", "open_containing_folder",
+    };
+    if (!m_imgv && viewCommands.contains(command))
+    {
+        error = "no image open";
+        return {};
+    }
+    it.value()();
+    return {};
 }
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
     setAttribute(Qt::WA_NativeWindow);
-    Magick::InitializeMagick(nullptr);
     setMinimumSize(600, 400);
 }
 
+// `files` are the ones about to be opened. The first of them start decoding
+// as soon as the config is known, so that the decode overlaps building the
+// menus and the rest of the config driven UI.
 void
-MainWindow::construct() noexcept
+MainWindow::construct(const QStringList &files) noexcept
 {
     initCommandMap();
+
+    // Whatever state the config is in, the decoder timings are kept
+    DecoderSelector::instance().load(CONFIG_DIR + "decoder_stats.json");
     initConfig();
-    initConnections();
+    StartupProfiler::mark("config");
+
+    for (qsizetype i = 0; i < files.size() && i <= m_config.behavior.prefetch_tabs; ++i)
+    {
+        QFuture<DecodeResult> started;
+        if (m_startup && m_startup->takeDecode(files[i], started))
+            m_image_cache.insert(resolveFilePath(files[i]), started);
+        else
+            m_image_cache.prefetch(resolveFilePath(files[i]));
+    }
+    m_startup = nullptr;
+    StartupProfiler::mark("decode_started");
 
+    initConnections();
     initGui();
+    StartupProfiler::mark("gui");
+    StartupProfiler::watchWindow(windowHandle(), !files.isEmpty());
 }
 
 void
@@ -225,6 +447,9 @@ MainWindow::initGui() noexcept
     m_toggle_auto_reload_action->setCheckable(true);
     m_toggle_auto_reload_action->setChecked(m_config.behavior.auto_reload);
 
+    m_help_menu->addAction(QString("Memory Usage\t%1").arg(m_config.shortcutMap["memory_usage"]), this,
+                           &MainWindow::ShowMemoryUsage);
+
     m_help_menu->addAction("About", this, [&]()
     {
         // TODO: Add custom widget
@@ -248,9 +473,13 @@ MainWindow::initGui() noexcept
 
     menuBar()->setVisible(m_config.ui.menubar_shown);
     m_panel->setVisible(m_config.ui.statusbar_shown);
+    updateMemoryReadout();
 
     updateMenuActions(false);
-    this->show();
+
+    // A daemon shows the window once a client opens files
+    if (!m_daemon)
+        this->show();
 }
 
 void
@@ -308,12 +537,6 @@ MainWindow::initConnections() noexcept
         }
     });
 
-    connect(m_tab_widget, &TabWidget::currentChanged, [&](int index)
-    {
-        m_imgv = qobject_cast<ImageView *>(m_tab_widget->widget(index));
-        updateFileinfoInPanel();
-    });
-
     connect(m_tab_widget, &TabWidget::tabCloseRequested, this, &MainWindow::handleTabClose);
 }
 
@@ -324,41 +547,61 @@ MainWindow::handleTabClose(int index) noexcept
     QWidget *widget = m_tab_widget->widget(index);
     if (!widget)
         return;
+
+    // The shared view must not go down with the tab hosting it
+    if (m_view && m_view->parentWidget() == widget)
+    {
+        m_view->hide();
+        m_view->setParent(this);
+    }
     widget->close();
     widget->deleteLater();
     m_tab_widget->removeTab(index);
 }
 
+// Tabs only carry a document; files are decoded once their tab becomes
+// current (or is next to the current one, see prefetchAround())
 void
 MainWindow::OpenFiles(const QList<QString> &files) noexcept
 {
-    QProgressDialog progress("Opening files...", "Cancel", 0, files.size(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
+    if (m_not_tabbed)
+    {
+        for (const QString &filepath : files)
+            OpenFile(filepath);
+        return;
+    }
+
+    int first = -1;
     for (const QString &filepath : files)
     {
-        OpenFile(filepath);
-        progress.setValue(progress.value() + 1);
-        if (progress.wasCanceled())
-            break;
+        const QString fp = resolveFilePath(filepath);
+        if (!QFileInfo::exists(fp))
+        {
+            qWarning() << "Failed to open file:" << fp;
+            QMessageBox::warning(this, "Open File Error", QString("Failed to open file:\n%1").arg(fp));
+            continue;
+        }
+
+        const int index = m_tab_widget->addTab(createDocumentTab(fp), fp);
+        if (first < 0)
+            first = index;
+    }
+
+    if (first >= 0)
+    {
+        m_tab_widget->setCurrentIndex(first);
+        prefetchAround(first);
     }
-    progress.close();
 }
 
 void
 MainWindow::OpenFiles(const std::vector<std::string> &files) noexcept
 {
-    QProgressDialog progress("Opening files...", "Cancel", 0, files.size(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
+    QStringList list;
+    list.reserve(files.size());
     for (const std::string &filepath : files)
-    {
-        OpenFile(QString::fromStdString(filepath));
-        progress.setValue(progress.value() + 1);
-        if (progress.wasCanceled())
-            break;
-    }
-    progress.close();
+        list.append(QString::fromStdString(filepath));
+    OpenFiles(list);
 }
 
 void
@@ -379,15 +622,31 @@ MainWindow::OpenFile(const QString &filepath) noexcept
         return;
     }
 
-    QString fp = filepath;
-
-    if (fp.isEmpty())
+    if (filepath.isEmpty())
     {
         QStringList filepaths = openFileDialog();
         OpenFiles(filepaths);
         return;
     }
 
+    const QString fp = resolveFilePath(filepath);
+    if (!QFileInfo::exists(fp))
+    {
+        qWarning() << "Failed to open file:" << fp;
+        QMessageBox::warning(this, "Open File Error", QString("Failed to open file:\n%1").arg(fp));
+        return;
+    }
+
+    DocumentTab *tab = createDocumentTab(fp);
+    m_tab_widget->addTab(tab, fp);
+    m_tab_widget->setCurrentWidget(tab); // Make it the active tab
+}
+
+QString
+MainWindow::resolveFilePath(const QString &filepath) const noexcept
+{
+    QString fp = filepath;
+
     if (QFileInfo(fp).isRelative() && m_config.ui.statusbar_filepath_complete)
     {
         fp = QDir::current().absoluteFilePath(fp);
@@ -396,32 +655,93 @@ MainWindow::OpenFile(const QString &filepath) noexcept
     if (fp.startsWith("~"))
         fp = fp.replace(0, 1, QString::fromLocal8Bit(getenv("HOME")));
 
-    m_imgv = new ImageView(m_config, m_tab_widget);
+    return fp;
+}
+
+DocumentTab *
+MainWindow::createDocumentTab(const QString &fp) noexcept
+{
+    ImageDocument doc;
+    doc.filepath   = fp;
+    doc.autoReload = m_config.behavior.auto_reload;
+
+    auto *tab = new DocumentTab(doc);
+    m_memory_governor->track(tab);
+    return tab;
+}
+
+// The one view of this window, moved into whichever tab is current
+ImageView *
+MainWindow::ensureView() noexcept
+{
+    if (m_view)
+        return m_view;
+
+    m_view = new ImageView(m_config, this);
+    m_view->setImageCache(&m_image_cache);
+    m_memory_governor->setView(m_view);
 
-    bool success = m_imgv->openFile(fp);
-    if (!success)
+    // Decoding finishes asynchronously, the tab is shown right away and either
+    // filled in or closed again once the result arrives. Closing is queued as
+    // a failure can be reported while the view is still switching documents.
+    connect(m_view, &ImageView::openFailed, this, [this](const QString &path)
     {
-        qWarning() << "Failed to open file:" << fp;
-        QMessageBox::warning(this, "Open File Error", QString("Failed to open file:\n%1").arg(fp));
+        qWarning() << "Failed to open file:" << path;
+        if (StartupProfiler::enabled())
+        {
+            StartupProfiler::finish("the file failed to open");
+            return;
+        }
+        QMessageBox::warning(this, "Open File Error", QString("Failed to open file:\n%1").arg(path));
 
-        m_imgv->deleteLater();
-        m_imgv = nullptr;
-    }
-    else
+        if (m_current_tab && m_current_tab->document().filepath == path)
+            handleTabClose(m_tab_widget->indexOf(m_current_tab));
+    }, Qt::QueuedConnection);
+
+    connect(m_view, &ImageView::imageLoaded, this, [this]()
     {
-        updateMenuActions(true);
+        if (m_current_tab && !m_current_tab->recorded())
+        {
+            if (m_recent_file_manager)
+                m_recent_file_manager->addFilePath(m_current_tab->document().filepath);
+            m_current_tab->setRecorded(true);
+        }
+
         updateFileinfoInPanel();
 
-        m_recent_file_manager->addFilePath(fp);
+        if (StartupProfiler::enabled())
+        {
+            StartupProfiler::mark("image_loaded");
+            StartupProfiler::watchFirstPixel(m_view->gview()->viewport());
+        }
+    });
 
-        if (m_config.behavior.auto_reload)
-            m_imgv->setAutoReload(true);
+    connect(m_view, &ImageView::openFilesRequested, this,
+            [&](const QStringList &files) { OpenFiles(files); }); // drop event
 
-        m_tab_widget->addTab(m_imgv, fp);
-        m_tab_widget->setCurrentWidget(m_imgv); // Make it the active tab
+    connect(m_view, &ImageView::viewportChanged, this, [this](const QRectF & /* sceneRect */)
+    {
+        if (m_imgv)
+            m_panel->setZoom(m_imgv->zoomLevel());
+    });
+
+    return m_view;
+}
 
-        connect(m_imgv, &ImageView::openFilesRequested, this,
-                [&](const QStringList &files) { OpenFiles(files); }); // drop event
+// Decode the documents of the tabs next to `index` ahead of time
+void
+MainWindow::prefetchAround(int index) noexcept
+{
+    // Neighbours of the previous tab give way to those of this one, nearest first
+    m_image_cache.cancelPrefetches();
+    for (int distance = 1; distance <= m_config.behavior.prefetch_tabs; ++distance)
+    {
+        for (const int i : { index + distance, index - distance })
+        {
+            auto *tab = dynamic_cast<DocumentTab *>(m_tab_widget->widget(i));
+            if (tab && tab->document().image.isNull())
+                m_image_cache.prefetch(tab->document().filepath);
+        }
     }
 }
 
@@ -435,7 +755,8 @@ MainWindow::CloseFile() noexcept
 void
 MainWindow::ZoomIn() noexcept
 {
-    m_imgv->zoomIn();
+    if (m_imgv)
+        m_imgv->zoomIn();
 }
 
 void
@@ -512,6 +833,9 @@ MainWindow::ToggleMenubar() noexcept
 void
 MainWindow::Scroll(Direction dir) noexcept
 {
+    if (!m_imgv)
+        return;
+
     switch (dir)
     {
         case Direction::LEFT:
@@ -540,7 +864,8 @@ MainWindow::handleFileDrop() noexcept
 void
 MainWindow::ToggleMinimap() noexcept
 {
-    m_imgv->toggleMinimap();
+    if (m_imgv)
+        m_imgv->toggleMinimap();
 }
 
 void
@@ -606,6 +931,7 @@ MainWindow::updateFileinfoInPanel() noexcept
     m_panel->setFileName(filepath);
     m_panel->setImageSize(size.width(), size.height());
     m_panel->setFileSize(m_imgv->fileSize());
+    m_panel->setZoom(m_imgv->zoomLevel());
     m_imgv->updateMinimapPosition();
     this->setWindowTitle(QString("iv: %1").arg(filepath));
 }
@@ -613,18 +939,18 @@ MainWindow::updateFileinfoInPanel() noexcept
 void
 MainWindow::initConfig() noexcept
 {
-    toml::table toml;
-
-    try
-    {
-        toml = toml::parse_file(m_config_file_path.toStdString());
-    }
-    catch (const toml::parse_error &e)
-    {
-        QMessageBox::critical(this, "Config Error", e.what());
-        return;
+    // At startup the file has been parsed on a worker already
+    ParsedConfig parsed =
+        m_startup ? m_startup->config(m_config_file_path) : ParsedConfig::parse(m_config_file_path);
+    // The rest of the setup still has to happen, with the settings as they were
+    if (!parsed.error.isEmpty())
+    {
+        QMessageBox::critical(this, "Config Error", parsed.error);
+        parsed.table = toml::table();
     }
 
+    toml::table &toml = parsed.table;
+
     // Read tab options
     auto ui = toml["ui"];
 
@@ -688,6 +1014,7 @@ MainWindow::initConfig() noexcept
 
         m_config.ui.statusbar_position          = ui["statusbar_position"].value_or("bottom");
         m_config.ui.statusbar_filepath_complete = ui["statusbar_filepath_complete"].value_or(true);
+        m_config.ui.statusbar_memory            = ui["statusbar_memory"].value_or(false);
     }
 
     auto focus_mode = toml["focus_mode"];
@@ -713,8 +1040,65 @@ MainWindow::initConfig() noexcept
         m_config.behavior.config_hot_reload        = behavior["config_hot_reload"].value_or(true);
         m_config.behavior.keybind_conflict_warning = behavior["keybind_conflict_warning"].value_or(true);
         m_config.behavior.copy_transformed_image   = behavior["copy_transformed_image"].value_or(false);
+        m_config.behavior.copy_viewport_native_resolution =
+            behavior["copy_viewport_native_resolution"].value_or(false);
+        m_config.behavior.memory_budget_mb       = behavior["memory_budget_mb"].value_or(4096);
+        m_config.behavior.prefetch_tabs          = behavior["prefetch_tabs"].value_or(2);
+        m_config.behavior.single_instance        = behavior["single_instance"].value_or(false);
+        m_config.behavior.command_server         = behavior["command_server"].value_or(false);
+        m_config.behavior.decode_workers         = behavior["decode_workers"].value_or(0);
+        m_config.behavior.decode_timeout_s       = behavior["decode_timeout_s"].value_or(30);
+        m_config.behavior.decode_memory_limit_mb = behavior["decode_memory_limit_mb"].value_or(4096);
+        m_config.behavior.max_decoded_mb         = behavior["max_decoded_mb"].value_or(1024);
+        m_config.behavior.max_frames             = behavior["max_frames"].value_or(1000);
     }
 
+    const qint64 memoryBudget = qint64(std::max(0, m_config.behavior.memory_budget_mb)) * 1024 * 1024;
+    m_memory_governor->setBudget(memoryBudget);
+
+    // Most of the cache is shared with open documents; it gets half the
+    // budget, or its default when the budget is off
+    m_image_cache.setBudget(memoryBudget > 0 ? memoryBudget / 2 : ImageCache::DEFAULT_BUDGET);
+    m_memory_governor->setImageCache(&m_image_cache);
+
+    DecodeLimits limits;
+    limits.maxBytes  = qint64(std::max(0, m_config.behavior.max_decoded_mb)) * 1024 * 1024;
+    limits.maxFrames = std::max(0, m_config.behavior.max_frames);
+    limits.timeoutMs = std::max(0, m_config.behavior.decode_timeout_s) * 1000;
+    ImageDecoder::setLimits(limits);
+
+    // Backend per format; formats that are not listed or "auto" go to the fastest measured one
+    m_config.decoderMap.clear();
+    if (auto decoders = toml["decoders"].as_table())
+    {
+        for (auto &[key, value] : *decoders)
+        {
+            const QString format  = QString::fromStdString(std::string(key.str())).toLower();
+            const QString backend = QString::fromStdString(value.value_or<std::string>("auto")).toLower();
+            if (backend != "auto" && backend != "qt" && backend != "magick" && backend != "avif")
+            {
+                qWarning() << "Unknown decoder" << backend << "for" << format << "in the config";
+                continue;
+            }
+            m_config.decoderMap[format] = backend;
+        }
+    }
+    DecoderSelector::instance().setOverrides(m_config.decoderMap);
+
+    if (m_config.behavior.decode_workers > 0)
+    {
+        if (!m_decoder_pool)
+            m_decoder_pool = new DecoderPool(this);
+        m_decoder_pool->configure(m_config.behavior.decode_workers, m_config.behavior.decode_timeout_s * 1000,
+                                  m_config.behavior.decode_memory_limit_mb);
+    }
+    else if (m_decoder_pool)
+    {
+        m_decoder_pool->deleteLater();
+        m_decoder_pool = nullptr;
+    }
+    m_image_cache.setDecoderPool(m_decoder_pool);
+
     if (m_config.behavior.config_hot_reload)
     {
         if (!m_config_file_watcher)
@@ -821,22 +1205,26 @@ MainWindow::initCommandMap() noexcept
 
     m_commandMap["left_edge"] = [this]()
     {
-        m_imgv->scrollToLeftEdge();
+        if (m_imgv)
+            m_imgv->scrollToLeftEdge();
     };
 
     m_commandMap["right_edge"] = [this]()
     {
-        m_imgv->scrollToRightEdge();
+        if (m_imgv)
+            m_imgv->scrollToRightEdge();
     };
 
     m_commandMap["top_edge"] = [this]()
     {
-        m_imgv->scrollToTopEdge();
+        if (m_imgv)
+            m_imgv->scrollToTopEdge();
     };
 
     m_commandMap["bottom_edge"] = [this]()
     {
-        m_imgv->scrollToBottomEdge();
+        if (m_imgv)
+            m_imgv->scrollToBottomEdge();
     };
 
     m_commandMap["open_file"] = [this]()
@@ -982,6 +1370,11 @@ MainWindow::initCommandMap() noexcept
         OpenContainingFolder();
     };
 
+    m_commandMap["memory_usage"] = [this]()
+    {
+        ShowMemoryUsage();
+    };
+
     for (int i = 1; i < 11; i++)
     {
         m_commandMap[QString("tab_%1").arg(i)] = [this, i]()
@@ -1032,6 +1425,9 @@ MainWindow::setupKeybinding(const QString &action, const QString &key) noexcept
 void
 MainWindow::Flip(Direction dir) noexcept
 {
+    if (!m_imgv)
+        return;
+
     switch (dir)
     {
         case Direction::LEFT:
@@ -1103,9 +1499,56 @@ MainWindow::updateMenuActions(bool state) noexcept
 void
 MainWindow::handleCurrentTabChanged(int index) noexcept
 {
-    m_imgv = qobject_cast<ImageView *>(m_tab_widget->widget(index));
-    updateMenuActions(m_imgv != nullptr);
+    auto *tab = dynamic_cast<DocumentTab *>(m_tab_widget->widget(index));
+
+    // Hand the outgoing document's state back before the view moves on
+    if (m_current_tab && m_view && tab != m_current_tab)
+        m_current_tab->document() = m_view->document();
+
+    const bool changed = tab != m_current_tab;
+    m_current_tab      = tab;
+    m_memory_governor->setCurrent(tab);
+
+    if (!tab)
+    {
+        if (m_view)
+        {
+            m_view->clear();
+            m_view->hide();
+            m_view->setParent(this);
+        }
+        m_imgv = nullptr;
+        updateMenuActions(false);
+        return;
+    }
+
+    m_imgv = ensureView();
+    if (changed)
+    {
+        tab->attachView(m_imgv);
+        m_imgv->setDocument(tab->document());
+    }
+
+    updateMenuActions(true);
     updateFileinfoInPanel();
+    prefetchAround(index);
+}
+
+// A daemon outlives its window: closing only drops the tabs and hides it,
+// the decode cache stays warm for the next client
+void
+MainWindow::closeEvent(QCloseEvent *e)
+{
+    if (!m_daemon)
+    {
+        QMainWindow::closeEvent(e);
+        return;
+    }
+
+    e->ignore();
+    while (m_tab_widget->count() > 0)
+        handleTabClose(0);
+    hide();
 }
 
 void
@@ -1211,15 +1654,12 @@ MainWindow::applyConfigChanges() noexcept
 
     menuBar()->setVisible(m_config.ui.menubar_shown);
     m_panel->setVisible(m_config.ui.statusbar_shown);
+    updateMemoryReadout();
 
-    for (int i = 0; i < m_tab_widget->count(); i++)
+    if (m_view)
     {
-        auto temp = qobject_cast<ImageView *>(m_tab_widget->widget(i));
-        if (temp)
-        {
-            temp->setConfig(m_config);
-            temp->UpdateFromConfig();
-        }
+        m_view->setConfig(m_config);
+        m_view->UpdateFromConfig();
     }
 }
 
@@ -1337,7 +1777,8 @@ MainWindow::CopyImageToClipboard() noexcept
         return;
 
     QImage img;
-    if (m_config.behavior.copy_transformed_image)
+    const bool transformed = m_config.behavior.copy_transformed_image && m_imgv->isTransformed();
+    if (transformed)
     {
         img = m_imgv->transformedImage();
     }
@@ -1345,8 +1786,65 @@ MainWindow::CopyImageToClipboard() noexcept
     {
         img = m_imgv->image();
     }
+
+    // Encoded lazily, and the untouched file is offered as is
+    auto *data = new ImageMimeData(img);
+    if (!transformed)
+        data->setSourceFile(m_imgv->filePath(), m_imgv->mimeType(), m_imgv->fileModified());
+
     QClipboard *clipboard = QGuiApplication::clipboard();
-    clipboard->setImage(img);
+    clipboard->setMimeData(data);
+}
+
+void
+MainWindow::ShowMemoryUsage() noexcept
+{
+    const MemoryReport report = m_memory_governor->report();
+
+    QMessageBox box(QMessageBox::Information, "Memory Usage", report.toText(), QMessageBox::Close, this);
+    QPushButton *save = box.addButton("Save as JSON...", QMessageBox::ActionRole);
+    box.exec();
+
+    if (box.clickedButton() != save)
+        return;
+
+    const QString path = QFileDialog::getSaveFileName(this, "Save Memory Report", "iv-memory.json", "JSON (*.json)");
+    if (path.isEmpty())
+        return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        QMessageBox::warning(this, "Save Memory Report", QString("Failed to write:\n%1").arg(path));
+        return;
+    }
+    file.write(QJsonDocument(report.toJson()).toJson());
+}
+
+// Periodic total in the statusbar, only while it is enabled
+void
+MainWindow::updateMemoryReadout() noexcept
+{
+    const bool enabled = m_config.ui.statusbar_memory;
+    m_panel->setMemoryVisible(enabled);
+
+    if (!enabled)
+    {
+        if (m_memory_timer)
+            m_memory_timer->stop();
+        return;
+    }
+
+    if (!m_memory_timer)
+    {
+        m_memory_timer = new QTimer(this);
+        m_memory_timer->setInterval(1000);
+        connect(m_memory_timer, &QTimer::timeout, this, [this]()
+        { m_panel->setMemory(ImageView::humanReadableSize(m_memory_governor->report().total())); });
+    }
+
+    m_panel->setMemory(ImageView::humanReadableSize(m_memory_governor->report().total()));
+    m_memory_timer->start();
 }
 
 void
@@ -1357,5 +1855,5 @@ MainWindow::CopyViewportImageToClipboard() noexcept
 
     QImage img            = m_imgv->viewportImage();
     QClipboard *clipboard = QGuiApplication::clipboard();
-    clipboard->setImage(img);
+    clipboard->setMimeData(new ImageMimeData(img));
 }
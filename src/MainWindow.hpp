@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Config.hpp"
+#include "ImageCache.hpp"
+#include "MemoryGovernor.hpp"
 #include "Panel.hpp"
 #include "RecentFilesManager.hpp"
 #include "TabWidget.hpp"
@@ -8,6 +10,7 @@
 
 #include <QApplication>
 #include <QFileSystemWatcher>
+#include <QJsonValue>
 #include <QMainWindow>
 #include <QMimeData>
 #include <QStandardPaths>
@@ -20,7 +23,11 @@
 #define CONFIG_DIR                                                                                                     \
     QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + QDir::separator() + "iv" + QDir::separator()
 
+class DocumentTab;
 class ImageView;
+class CommandServer;
+class SingleInstance;
+class StartupOrchestrator;
 
 class MainWindow : public QMainWindow
 {
@@ -35,8 +42,8 @@ public:
         DOWN
     };
 
-    void construct() noexcept;
-    void readArgs(argparse::ArgumentParser &parser) noexcept;
+    void construct(const QStringList &files = {}) noexcept;
+    void readArgs(argparse::ArgumentParser &parser, StartupOrchestrator *startup = nullptr) noexcept;
     void initConnections() noexcept;
     void handleFileDrop() noexcept;
 
@@ -73,6 +80,7 @@ public:
     void CopyFilePathToClipboard() noexcept;
     void CopyFileDirToClipboard() noexcept;
     void CopyViewportImageToClipboard() noexcept;
+    void ShowMemoryUsage() noexcept;
 
     QTabWidget::TabPosition tabBarPositionFromString(const QString &position) const noexcept;
 
@@ -86,6 +94,7 @@ protected:
     void dragEnterEvent(QDragEnterEvent *e) override;
     void dropEvent(QDropEvent *e) override;
     void resizeEvent(QResizeEvent *e) override;
+    void closeEvent(QCloseEvent *e) override;
 
 private:
     void initGui() noexcept;
@@ -96,12 +105,21 @@ private:
     void updateFileinfoInPanel() noexcept;
     QStringList openFileDialog() noexcept;
     void handleTabClose(int index) noexcept;
+    QString resolveFilePath(const QString &filepath) const noexcept;
+    DocumentTab *createDocumentTab(const QString &fp) noexcept;
+    ImageView *ensureView() noexcept;
+    void prefetchAround(int index) noexcept;
+    void updateMemoryReadout() noexcept;
+    void initSingleInstance() noexcept;
+    void initCommandServer() noexcept;
+    QJsonValue runCommand(const QString &command, const QString &argument, QString &error) noexcept;
     void updateMenuActions(bool state) noexcept;
     void handleCurrentTabChanged(int index) noexcept;
     void onConfigFileChanged(const QString &filePath) noexcept;
     void applyConfigChanges() noexcept;
     void updateTabBarVisibility() noexcept;
-    bool m_default_keybindings{true}, m_not_tabbed{false};
+    bool m_default_keybindings{true}, m_not_tabbed{false}, m_single_instance{false};
+    bool m_daemon{false}; // no window until a client asks to open files
 
     QMenu *m_file_menu{nullptr};
     QMenu *m_view_menu{nullptr};
@@ -152,6 +170,15 @@ private:
     float m_dpr{1.0f};
     Config m_config;
     RecentFilesManager *m_recent_file_manager{nullptr};
+    MemoryGovernor *m_memory_governor{new MemoryGovernor(this)};
+    ImageCache m_image_cache;
+    ImageView *m_view{nullptr};         // shared by all tabs
+    DocumentTab *m_current_tab{nullptr}; // tab m_view is showing
+    QTimer *m_memory_timer{nullptr};
+    StartupOrchestrator *m_startup{nullptr}; // until construct() has joined its results
+    SingleInstance *m_single_instance_server{nullptr};
+    CommandServer *m_command_server{nullptr};
+    DecoderPool *m_decoder_pool{nullptr}; // only with behavior.decode_workers
     QMap<QString, float> m_screen_dpr_map; // DPR per screen
     QMap<QString, QShortcut *> m_shortcut_map;
     QFileSystemWatcher *m_config_file_watcher{nullptr};
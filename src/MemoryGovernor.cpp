@@ -0,0 +1,261 @@
+#include "MemoryGovernor.hpp"
+
+#include "DocumentTab.hpp"
+#include "ImageCache.hpp"
+#include "ImageView.hpp"
+#include "PixelOps.hpp"
+
+#include <QJsonArray>
+#include <QSet>
+#include <QTimer>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+// Longer side of the preview an evicted document keeps, at most
+constexpr int PREVIEW_SIZE = 512;
+
+QImage
+previewOf(const QImage &image) noexcept
+{
+    if (image.depth() != 32)
+        return image.scaled(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    QImage preview = image;
+    while (std::max(preview.width(), preview.height()) > PREVIEW_SIZE &&
+           std::min(preview.width(), preview.height()) > 1)
+        preview = PixelOps::halfScale(preview);
+    return preview;
+}
+
+} // namespace
+
+qint64
+MemoryReport::total() const noexcept
+{
+    qint64 sum = 0;
+    for (const qint64 bytes : totals)
+        sum += bytes;
+    return sum;
+}
+
+QJsonObject
+MemoryReport::toJson() const noexcept
+{
+    auto usageObject = [](const QMap<QString, qint64> &usage)
+    {
+        QJsonObject obj;
+        for (auto it = usage.constBegin(); it != usage.constEnd(); ++it)
+            obj.insert(it.key(), it.value());
+        return obj;
+    };
+
+    QJsonArray tabArray;
+    for (const Tab &tab : tabs)
+    {
+        QJsonObject obj;
+        obj["path"]    = tab.filepath;
+        obj["current"] = tab.current;
+        obj["bytes"]   = usageObject(tab.usage);
+        tabArray.append(obj);
+    }
+
+    QJsonObject root;
+    root["total"]  = total();
+    root["budget"] = budget;
+    root["totals"] = usageObject(totals);
+    root["tabs"]   = tabArray;
+    return root;
+}
+
+QString
+MemoryReport::toText() const noexcept
+{
+    QString text = QString("Total: %1").arg(ImageView::humanReadableSize(total()));
+    if (budget > 0)
+        text += QString(" (budget %1)").arg(ImageView::humanReadableSize(budget));
+    text += "\n";
+
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it)
+    {
+        if (it.value() > 0)
+            text += QString("    %1: %2\n").arg(it.key(), ImageView::humanReadableSize(it.value()));
+    }
+
+    text += QString("\nTabs (most recently viewed first):\n");
+    for (const Tab &tab : tabs)
+    {
+        qint64 bytes = 0;
+        for (const qint64 b : tab.usage)
+            bytes += b;
+        text += QString("%1 %2: %3\n")
+                    .arg(tab.current ? "*" : " ", tab.filepath, ImageView::humanReadableSize(bytes));
+    }
+
+    return text;
+}
+
+void
+MemoryGovernor::setBudget(qint64 bytes) noexcept
+{
+    m_budget = bytes;
+    scheduleEnforce();
+}
+
+void
+MemoryGovernor::setView(ImageView *view) noexcept
+{
+    if (m_view == view)
+        return;
+
+    m_view = view;
+    if (view)
+        connect(view, &ImageView::memoryUsageChanged, this, &MemoryGovernor::scheduleEnforce);
+}
+
+void
+MemoryGovernor::track(DocumentTab *tab) noexcept
+{
+    if (!tab || m_last_viewed.contains(tab))
+        return;
+
+    m_last_viewed.insert(tab, ++m_clock);
+
+    connect(tab, &QObject::destroyed, this, [this, tab]()
+    {
+        m_last_viewed.remove(tab);
+        if (m_current == tab)
+            m_current = nullptr;
+    });
+}
+
+void
+MemoryGovernor::setCurrent(DocumentTab *tab) noexcept
+{
+    m_current = tab;
+    if (!tab)
+        return;
+
+    m_last_viewed[tab] = ++m_clock;
+    scheduleEnforce();
+}
+
+// The current document's pixels live in the view (along with its render
+// caches); background documents only hold their decoded image
+qint64
+MemoryGovernor::bytes(DocumentTab *tab) const noexcept
+{
+    if (tab == m_current && m_view)
+        return m_view->decodedBytes();
+    return tab->document().bytes();
+}
+
+qint64
+MemoryGovernor::totalBytes() const noexcept
+{
+    qint64 total = 0;
+    for (auto it = m_last_viewed.constBegin(); it != m_last_viewed.constEnd(); ++it)
+        total += bytes(it.key());
+    return total;
+}
+
+MemoryReport
+MemoryGovernor::report() const noexcept
+{
+    MemoryReport report;
+    report.budget = m_budget;
+
+    QSet<qint64> counted; // images already in a tab's total, by cacheKey()
+    QList<DocumentTab *> order = m_last_viewed.keys();
+    std::sort(order.begin(), order.end(),
+              [this](DocumentTab *a, DocumentTab *b) { return m_last_viewed.value(a) > m_last_viewed.value(b); });
+
+    for (DocumentTab *tab : order)
+    {
+        MemoryReport::Tab entry;
+        entry.filepath = tab->document().filepath;
+        entry.current  = tab == m_current;
+        if (entry.current && m_view)
+        {
+            entry.usage = m_view->memoryUsage();
+            counted.insert(m_view->image().cacheKey());
+        }
+        else
+        {
+            entry.usage["source"] = tab->document().bytes();
+            counted.insert(tab->document().image.cacheKey());
+        }
+
+        for (auto it = entry.usage.constBegin(); it != entry.usage.constEnd(); ++it)
+            report.totals[it.key()] += it.value();
+        report.tabs.append(entry);
+    }
+
+    // Only what the cache holds on its own: prefetches not shown yet and
+    // images of documents that were evicted or closed
+    if (m_cache)
+        report.totals["decode_cache"] = m_cache->bytes(counted);
+
+    // ImageMagick's pixel cache, heap and memory mapped
+    if (ImageDecoder::initialized())
+        report.totals["magick_pixel_cache"] =
+            qint64(MagickCore::GetMagickResource(MagickCore::MemoryResource) +
+                   MagickCore::GetMagickResource(MagickCore::MapResource));
+
+    return report;
+}
+
+// A decode and its mip chain finish in quick succession; settle them once
+// from the event loop
+void
+MemoryGovernor::scheduleEnforce() noexcept
+{
+    if (m_budget <= 0 || m_enforce_pending)
+        return;
+
+    m_enforce_pending = true;
+    QTimer::singleShot(0, this, &MemoryGovernor::enforce);
+}
+
+void
+MemoryGovernor::enforce() noexcept
+{
+    m_enforce_pending = false;
+    if (m_budget <= 0)
+        return;
+
+    qint64 total = totalBytes();
+    while (total > m_budget)
+    {
+        DocumentTab *victim = nullptr;
+        quint64 oldest      = std::numeric_limits<quint64>::max();
+
+        for (auto it = m_last_viewed.constBegin(); it != m_last_viewed.constEnd(); ++it)
+        {
+            DocumentTab *tab = it.key();
+            if (tab == m_current || tab->document().image.isNull())
+                continue;
+
+            if (it.value() < oldest)
+            {
+                oldest = it.value();
+                victim = tab;
+            }
+        }
+
+        if (!victim)
+            break;
+
+        // The cache entry shares the pixels; without dropping it too nothing is freed
+        ImageDocument &doc = victim->document();
+        total -= doc.bytes();
+        doc.preview     = previewOf(doc.image);
+        doc.previewSize = doc.image.size();
+        doc.image       = QImage();
+        total += doc.bytes();
+        if (m_cache)
+            m_cache->remove(doc.filepath);
+    }
+}
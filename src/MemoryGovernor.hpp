@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QObject>
+
+class DocumentTab;
+class ImageCache;
+class ImageView;
+
+// Snapshot of the memory a window holds, see MemoryGovernor::report()
+struct MemoryReport
+{
+    struct Tab
+    {
+        QString filepath;
+        bool current{false};
+        QMap<QString, qint64> usage; // bytes by category
+    };
+
+    QMap<QString, qint64> totals; // by category, over all tabs and shared caches
+    QList<Tab> tabs;              // most recently viewed first
+    qint64 budget{0};
+
+    qint64 total() const noexcept;
+    QJsonObject toJson() const noexcept;
+    QString toText() const noexcept;
+};
+
+// Keeps the decoded pixels of all open documents under a byte budget by
+// dropping the pixels of the least recently viewed background documents down
+// to a small preview, along with their entries in the decode cache, which
+// would hold on to them otherwise. The current document is never touched; an
+// evicted document shows its preview when its tab becomes current and is
+// decoded again.
+class MemoryGovernor : public QObject
+{
+    Q_OBJECT
+public:
+    MemoryGovernor(QObject *parent = nullptr) : QObject(parent)
+    {
+    }
+
+    // 0 disables the budget
+    void setBudget(qint64 bytes) noexcept;
+
+    inline qint64 budget() const noexcept
+    {
+        return m_budget;
+    }
+
+    // The view showing the current document; its caches count towards it
+    void setView(ImageView *view) noexcept;
+
+    inline void setImageCache(ImageCache *cache) noexcept
+    {
+        m_cache = cache;
+    }
+
+    void track(DocumentTab *tab) noexcept;
+    void setCurrent(DocumentTab *tab) noexcept;
+
+    qint64 totalBytes() const noexcept;
+    MemoryReport report() const noexcept;
+
+private:
+    qint64 bytes(DocumentTab *tab) const noexcept;
+    void scheduleEnforce() noexcept;
+    void enforce() noexcept;
+
+    QHash<DocumentTab *, quint64> m_last_viewed;
+    DocumentTab *m_current{nullptr};
+    ImageView *m_view{nullptr};
+    ImageCache *m_cache{nullptr};
+    quint64 m_clock{0};
+    qint64 m_budget{0};
+    bool m_enforce_pending{false};
+};
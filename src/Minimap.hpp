@@ -159,6 +159,11 @@ public:
         updateSceneRect();
     }
 
+    inline QPixmap pixmap() const noexcept
+    {
+        return m_pix_item->pixmap();
+    }
+
     void setRotation(int angle) noexcept
     {
         m_pix_item->setTransformOriginPoint(m_pix_item->boundingRect().center());
@@ -10,9 +10,14 @@ Panel::Panel(QWidget *parent) : QWidget(parent)
     m_filename_label    = new ElidableLabel();
     m_filesize_label    = new QLabel();
     m_imgsize_label     = new QLabel();
+    m_zoom_label        = new QLabel();
+    m_memory_label      = new QLabel();
+    m_memory_label->setVisible(false);
     layout->addWidget(m_filename_label);
+    layout->addWidget(m_zoom_label);
     layout->addWidget(m_imgsize_label);
     layout->addWidget(m_filesize_label);
+    layout->addWidget(m_memory_label);
 }
 
 void
@@ -34,10 +39,29 @@ Panel::setImageSize(int width, int height) noexcept
     m_imgsize_label->setText(sizelabel);
 }
 
+void
+Panel::setZoom(qreal zoom) noexcept
+{
+    m_zoom_label->setText(QString("%1%").arg(qRound(zoom * 100)));
+}
+
+void
+Panel::setMemory(const QString &memory) noexcept
+{
+    m_memory_label->setText(QString("Mem: %1").arg(memory));
+}
+
+void
+Panel::setMemoryVisible(bool visible) noexcept
+{
+    m_memory_label->setVisible(visible);
+}
+
 void
 Panel::clear() noexcept
 {
     m_filename_label->clear();
+    m_zoom_label->clear();
     m_imgsize_label->clear();
     m_filesize_label->clear();
 }
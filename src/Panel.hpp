@@ -13,10 +13,15 @@ public:
     void setFileName(const QString &name) noexcept;
     void setFileSize(const QString &size) noexcept;
     void setImageSize(int w, int h) noexcept;
+    void setZoom(qreal zoom) noexcept;
+    void setMemory(const QString &memory) noexcept;
+    void setMemoryVisible(bool visible) noexcept;
     void clear() noexcept;
 
 private:
     ElidableLabel *m_filename_label{nullptr};
     QLabel *m_filesize_label{nullptr};
     QLabel *m_imgsize_label{nullptr};
+    QLabel *m_zoom_label{nullptr};
+    QLabel *m_memory_label{nullptr};
 };
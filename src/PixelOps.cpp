@@ -0,0 +1,749 @@
+#include "PixelOps.hpp"
+
+#include "DecodeScheduler.hpp"
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define IV_PIXELOPS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+#ifdef IV_PIXELOPS_X86
+bool
+cpuHasAVX2() noexcept
+{
+#if defined(__GNUC__)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+bool
+cpuHasSSE41() noexcept
+{
+#if defined(__GNUC__)
+    static const bool sse41 = __builtin_cpu_supports("sse4.1");
+    return sse41;
+#else
+    return false;
+#endif
+}
+#endif
+
+// Run fn(firstRow, lastRow) over [0, rows) in bands on the global thread pool.
+// Small images are not worth the hand-off. Prefetch and maintenance tasks
+// keep to their own idle priority thread instead of fanning out onto the
+// normal priority threads of the global pool.
+template <typename Fn>
+void
+parallelRows(int rows, qint64 bytesPerRow, Fn &&fn)
+{
+    constexpr qint64 minBandBytes = 1 << 20;
+
+    const int threads = DecodeScheduler::currentPriority() == DecodeScheduler::Priority::Visible
+                            ? std::max(1, QThreadPool::globalInstance()->maxThreadCount())
+                            : 1;
+    const int bands   = static_cast<int>(
+        std::clamp<qint64>(rows * bytesPerRow / minBandBytes, 1, std::min<qint64>(threads, rows)));
+    if (bands <= 1)
+    {
+        fn(0, rows);
+        return;
+    }
+
+    QVector<int> indices(bands);
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [&](int band)
+    {
+        fn(static_cast<int>(qint64(band) * rows / bands), static_cast<int>(qint64(band + 1) * rows / bands));
+    });
+}
+
+// --- Premultiplication and swizzling ------------------------------------
+
+// c * a / 255, rounded, exact for all 8 bit inputs
+inline uint8_t
+mul255(unsigned c, unsigned a) noexcept
+{
+    const unsigned t = c * a + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+// RGBA (swizzle) or BGRA bytes in, premultiplied BGRA (= ARGB32 in memory on
+// little endian) out. Returns the AND of all alpha values.
+uint8_t
+premultiplyRowScalar(const uint8_t *src, uint8_t *dst, int width, bool swizzle) noexcept
+{
+    uint8_t alphaAnd = 0xFF;
+    const int r      = swizzle ? 0 : 2;
+    const int b      = swizzle ? 2 : 0;
+    for (int x = 0; x < width; ++x, src += 4, dst += 4)
+    {
+        const uint8_t a = src[3];
+        const uint8_t R = src[r], G = src[1], B = src[b];
+        dst[0]          = mul255(B, a);
+        dst[1]          = mul255(G, a);
+        dst[2]          = mul255(R, a);
+        dst[3]          = a;
+        alphaAnd &= a;
+    }
+    return alphaAnd;
+}
+
+void
+rgbToRgb32RowScalar(const uint8_t *src, uint8_t *dst, int width) noexcept
+{
+    for (int x = 0; x < width; ++x, src += 3, dst += 4)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 0xFF;
+    }
+}
+
+#ifdef IV_PIXELOPS_X86
+__attribute__((target("sse4.1"))) int
+premultiplyRowSSE41(const uint8_t *src, uint8_t *dst, int width, bool swizzle, uint8_t &alphaAnd) noexcept
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i ones  = _mm_set1_epi8(-1);
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i amask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    const __m128i a255  = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i shuf =
+        swizzle ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    __m128i acc = ones;
+    int x       = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4)), shuf);
+        acc             = _mm_and_si128(acc, v);
+
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+        // Broadcast each pixel's alpha to its colour lanes, alpha lanes get 255
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        alo         = _mm_or_si128(_mm_andnot_si128(amask, alo), a255);
+        ahi         = _mm_or_si128(_mm_andnot_si128(amask, ahi), a255);
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), round);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(acc, ones)) & 0x8888) != 0x8888)
+        alphaAnd = 0;
+    return x;
+}
+
+__attribute__((target("avx2"))) int
+premultiplyRowAVX2(const uint8_t *src, uint8_t *dst, int width, bool swizzle, uint8_t &alphaAnd) noexcept
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i ones  = _mm256_set1_epi8(-1);
+    const __m256i round = _mm256_set1_epi16(128);
+    const __m256i amask = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    const __m256i a255  = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    const __m256i shuf  = swizzle ? _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0,
+                                                     3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                                  : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2,
+                                                     3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    __m256i acc = ones;
+    int x       = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256i v =
+            _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4)), shuf);
+        acc = _mm256_and_si256(acc, v);
+
+        // unpack/pack work per 128-bit lane, so pixel order is preserved
+        __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        __m256i hi = _mm256_unpackhi_epi8(v, zero);
+
+        __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+        alo         = _mm256_or_si256(_mm256_andnot_si256(amask, alo), a255);
+        ahi         = _mm256_or_si256(_mm256_andnot_si256(amask, ahi), a255);
+
+        lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), round);
+        hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), round);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4), _mm256_packus_epi16(lo, hi));
+    }
+
+    if ((static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(acc, ones))) & 0x88888888u) != 0x88888888u)
+        alphaAnd = 0;
+    return x;
+}
+
+__attribute__((target("sse4.1"))) int
+rgbToRgb32RowSSE41(const uint8_t *src, uint8_t *dst, int width) noexcept
+{
+    const __m128i shuf  = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    // Each 16 byte load covers 4 pixels plus 4 bytes of the next ones
+    int x = 0;
+    for (; x + 6 <= width; x += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuf), alpha));
+    }
+    return x;
+}
+
+__attribute__((target("avx2"))) int
+rgbToRgb32RowAVX2(const uint8_t *src, uint8_t *dst, int width) noexcept
+{
+    const __m256i shuf  = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4,
+                                           3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    // Pixels 0-3 go to the low lane and 4-7 (starting at byte 12) to the high lane
+    int x = 0;
+    for (; x + 10 <= width; x += 8)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3 + 12));
+        const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4),
+                            _mm256_or_si256(_mm256_shuffle_epi8(v, shuf), alpha));
+    }
+    return x;
+}
+#endif
+
+uint8_t
+premultiplyRow(const uint8_t *src, uint8_t *dst, int width, bool swizzle) noexcept
+{
+    uint8_t alphaAnd = 0xFF;
+    int done         = 0;
+#ifdef IV_PIXELOPS_X86
+    if (cpuHasAVX2())
+        done = premultiplyRowAVX2(src, dst, width, swizzle, alphaAnd);
+    if (cpuHasSSE41())
+        done += premultiplyRowSSE41(src + done * 4, dst + done * 4, width - done, swizzle, alphaAnd);
+#endif
+    return alphaAnd & premultiplyRowScalar(src + done * 4, dst + done * 4, width - done, swizzle);
+}
+
+void
+rgbToRgb32Row(const uint8_t *src, uint8_t *dst, int width) noexcept
+{
+    int done = 0;
+#ifdef IV_PIXELOPS_X86
+    if (cpuHasAVX2())
+        done = rgbToRgb32RowAVX2(src, dst, width);
+    if (cpuHasSSE41())
+        done += rgbToRgb32RowSSE41(src + done * 3, dst + done * 4, width - done);
+#endif
+    rgbToRgb32RowScalar(src + done * 3, dst + done * 4, width - done);
+}
+
+// Premultiply every row of `src` into `dst` (which may be the same image)
+bool
+premultiplyRows(const QImage &src, QImage &dst, bool swizzle) noexcept
+{
+    std::atomic<bool> opaque{true};
+    const int width           = src.width();
+    uint8_t *out              = dst.bits();
+    const qsizetype dstStride = dst.bytesPerLine();
+
+    parallelRows(src.height(), dstStride, [&](int first, int last)
+    {
+        uint8_t alphaAnd = 0xFF;
+        for (int y = first; y < last; ++y)
+            alphaAnd &= premultiplyRow(src.constScanLine(y), out + y * dstStride, width, swizzle);
+        if (alphaAnd != 0xFF)
+            opaque.store(false, std::memory_order_relaxed);
+    });
+
+    return opaque.load();
+}
+
+// --- 2x2 box filter ------------------------------------------------------
+
+void
+halfScaleRowScalar(const uint8_t *r0, const uint8_t *r1, uint8_t *dst, int dstWidth) noexcept
+{
+    for (int x = 0; x < dstWidth; ++x)
+    {
+        const uint8_t *a = r0 + x * 8;
+        const uint8_t *b = r1 + x * 8;
+        for (int c = 0; c < 4; ++c)
+            dst[x * 4 + c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+    }
+}
+
+#ifdef IV_PIXELOPS_X86
+// SSE2 is part of the x86-64 baseline, so this needs no runtime check
+int
+halfScaleRowSSE2(const uint8_t *r0, const uint8_t *r1, uint8_t *dst, int dstWidth) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two  = _mm_set1_epi16(2);
+
+    int x = 0;
+    for (; x + 4 <= dstWidth; x += 4)
+    {
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x * 8));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x * 8 + 16));
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x * 8));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x * 8 + 16));
+
+        // Vertical sums, two source pixels per register
+        const __m128i v01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        const __m128i v23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        const __m128i v45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        const __m128i v67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // Horizontal pair sums end up in the low 64 bits of each register
+        const __m128i h0 = _mm_add_epi16(v01, _mm_srli_si128(v01, 8));
+        const __m128i h1 = _mm_add_epi16(v23, _mm_srli_si128(v23, 8));
+        const __m128i h2 = _mm_add_epi16(v45, _mm_srli_si128(v45, 8));
+        const __m128i h3 = _mm_add_epi16(v67, _mm_srli_si128(v67, 8));
+
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(h0, h1), two), 2);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(h2, h3), two), 2);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("avx2"))) int
+halfScaleRowAVX2(const uint8_t *r0, const uint8_t *r1, uint8_t *dst, int dstWidth) noexcept
+{
+    const __m256i two = _mm256_set1_epi16(2);
+
+    int x = 0;
+    for (; x + 8 <= dstWidth; x += 8)
+    {
+        const __m256 a0 = _mm256_loadu_ps(reinterpret_cast<const float *>(r0 + x * 8));
+        const __m256 a1 = _mm256_loadu_ps(reinterpret_cast<const float *>(r0 + x * 8 + 32));
+        const __m256 b0 = _mm256_loadu_ps(reinterpret_cast<const float *>(r1 + x * 8));
+        const __m256 b1 = _mm256_loadu_ps(reinterpret_cast<const float *>(r1 + x * 8 + 32));
+
+        // Split even and odd pixels; the shuffle works per 128-bit lane, the
+        // permute restores source order
+        const __m256i ae = _mm256_permute4x64_epi64(
+            _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i ao = _mm256_permute4x64_epi64(
+            _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i be = _mm256_permute4x64_epi64(
+            _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i bo = _mm256_permute4x64_epi64(
+            _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0));
+
+        // Widen to 16 bits and sum the four taps, four pixels per register
+        const __m256i lo = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(ae)),
+                             _mm256_cvtepu8_epi16(_mm256_castsi256_si128(ao))),
+            _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(be)),
+                             _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bo))));
+        const __m256i hi = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(ae, 1)),
+                             _mm256_cvtepu8_epi16(_mm256_extracti128_si256(ao, 1))),
+            _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(be, 1)),
+                             _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bo, 1))));
+
+        // packus interleaves lanes, permute puts the 8 pixels back in order
+        const __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(_mm256_add_epi16(lo, two), 2),
+                                                   _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4),
+                            _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return x;
+}
+#endif
+
+void
+halfScaleRow(const uint8_t *r0, const uint8_t *r1, uint8_t *dst, int dstWidth) noexcept
+{
+    int done = 0;
+#ifdef IV_PIXELOPS_X86
+    if (cpuHasAVX2())
+        done = halfScaleRowAVX2(r0, r1, dst, dstWidth);
+    done += halfScaleRowSSE2(r0 + done * 8, r1 + done * 8, dst + done * 4, dstWidth - done);
+#endif
+    halfScaleRowScalar(r0 + done * 8, r1 + done * 8, dst + done * 4, dstWidth - done);
+}
+
+// --- Orthogonal rotation and flipping -----------------------------------
+
+// Destination of source pixel (x, y) is base + x * stepX + y * stepY (bytes)
+struct OrientMapping
+{
+    qsizetype base;
+    qsizetype stepX;
+    qsizetype stepY;
+};
+
+OrientMapping
+orientMapping(PixelOps::Orientation o, int w, int h, qsizetype dstStride) noexcept
+{
+    using O = PixelOps::Orientation;
+
+    // Destination coordinates as x' = ax + bx * x + cx * y, y' = ay + by * x + cy * y
+    qsizetype ax = 0, bx = 1, cx = 0, ay = 0, by = 0, cy = 1;
+    switch (o)
+    {
+        case O::Identity:
+            break;
+        case O::FlipHorizontal:
+            ax = w - 1, bx = -1;
+            break;
+        case O::FlipVertical:
+            ay = h - 1, cy = -1;
+            break;
+        case O::Rotate180:
+            ax = w - 1, bx = -1, ay = h - 1, cy = -1;
+            break;
+        case O::Transpose:
+            bx = 0, cx = 1, by = 1, cy = 0;
+            break;
+        case O::Rotate90:
+            ax = h - 1, bx = 0, cx = -1, by = 1, cy = 0;
+            break;
+        case O::Transverse:
+            ax = h - 1, bx = 0, cx = -1, ay = w - 1, by = -1, cy = 0;
+            break;
+        case O::Rotate270:
+            bx = 0, cx = 1, ay = w - 1, by = -1, cy = 0;
+            break;
+    }
+
+    return { ay * dstStride + ax * 4, by * dstStride + bx * 4, cy * dstStride + cx * 4 };
+}
+
+// Rows of the source map to rows of the destination, possibly mirrored
+void
+orientRow(const uint32_t *src, uint8_t *dst, int width, qsizetype stepX) noexcept
+{
+    if (stepX > 0)
+    {
+        std::memcpy(dst, src, size_t(width) * 4);
+        return;
+    }
+
+    // Mirrored: dst points at the destination of src[0], the right end
+    uint32_t *out = reinterpret_cast<uint32_t *>(dst) - (width - 1);
+    int x         = 0;
+#ifdef IV_PIXELOPS_X86
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + width - x - 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+#endif
+    for (; x < width; ++x)
+        out[width - 1 - x] = src[x];
+}
+
+// Rows of the source map to columns of the destination. Work through square
+// tiles so that both the reads and the scattered writes stay in cache, and
+// transpose 4x4 blocks in registers inside a tile.
+void
+orientTransposeRows(const QImage &src, uint8_t *dst, const OrientMapping &m, int first, int last) noexcept
+{
+    constexpr int tile = 64;
+
+    const int width            = src.width();
+    const qsizetype srcStride  = src.bytesPerLine();
+    const uint8_t *srcBits     = src.constBits();
+    const bool reversedColumns = m.stepY < 0;
+
+    auto at = [&](int x, int y) { return reinterpret_cast<uint32_t *>(dst + m.base + x * m.stepX + y * m.stepY); };
+
+    for (int ty = first; ty < last; ty += tile)
+    {
+        const int yend = std::min(ty + tile, last);
+        for (int tx = 0; tx < width; tx += tile)
+        {
+            const int xend = std::min(tx + tile, width);
+            int y          = ty;
+#ifdef IV_PIXELOPS_X86
+            for (; y + 4 <= yend; y += 4)
+            {
+                const uint32_t *r0 = reinterpret_cast<const uint32_t *>(srcBits + y * srcStride);
+                const uint32_t *r1 = reinterpret_cast<const uint32_t *>(srcBits + (y + 1) * srcStride);
+                const uint32_t *r2 = reinterpret_cast<const uint32_t *>(srcBits + (y + 2) * srcStride);
+                const uint32_t *r3 = reinterpret_cast<const uint32_t *>(srcBits + (y + 3) * srcStride);
+
+                int x = tx;
+                for (; x + 4 <= xend; x += 4)
+                {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x));
+                    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r2 + x));
+                    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r3 + x));
+
+                    const __m128i ab0 = _mm_unpacklo_epi32(a, b);
+                    const __m128i ab1 = _mm_unpackhi_epi32(a, b);
+                    const __m128i cd0 = _mm_unpacklo_epi32(c, d);
+                    const __m128i cd1 = _mm_unpackhi_epi32(c, d);
+
+                    // col[i] holds source column x + i, rows y .. y + 3
+                    __m128i col[4] = { _mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0),
+                                       _mm_unpacklo_epi64(ab1, cd1), _mm_unpackhi_epi64(ab1, cd1) };
+
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        if (reversedColumns)
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(at(x + i, y + 3)),
+                                             _mm_shuffle_epi32(col[i], _MM_SHUFFLE(0, 1, 2, 3)));
+                        else
+                            _mm_storeu_si128(reinterpret_cast<__m128i *>(at(x + i, y)), col[i]);
+                    }
+                }
+
+                for (; x < xend; ++x)
+                {
+                    *at(x, y)     = r0[x];
+                    *at(x, y + 1) = r1[x];
+                    *at(x, y + 2) = r2[x];
+                    *at(x, y + 3) = r3[x];
+                }
+            }
+#endif
+            for (; y < yend; ++y)
+            {
+                const uint32_t *row = reinterpret_cast<const uint32_t *>(srcBits + y * srcStride);
+                for (int x = tx; x < xend; ++x)
+                    *at(x, y) = row[x];
+            }
+        }
+    }
+}
+
+} // namespace
+
+namespace PixelOps
+{
+
+bool
+premultiply(QImage &img) noexcept
+{
+    if (img.format() != QImage::Format_ARGB32)
+        return false;
+
+    return premultiplyRows(img, img, false);
+}
+
+QImage
+normalize(QImage img) noexcept
+{
+    if (img.isNull())
+        return img;
+
+    switch (img.format())
+    {
+        case QImage::Format_ARGB32_Premultiplied:
+        case QImage::Format_RGB32:
+            return img;
+
+        case QImage::Format_ARGB32:
+        {
+            const bool opaque = premultiply(img);
+            img.reinterpretAsFormat(opaque ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied);
+            return img;
+        }
+
+        case QImage::Format_RGBA8888:
+        case QImage::Format_RGBX8888:
+        {
+            QImage dst(img.size(), QImage::Format_ARGB32_Premultiplied);
+            if (dst.isNull())
+                return {};
+            if (premultiplyRows(img, dst, true))
+                dst.reinterpretAsFormat(QImage::Format_RGB32);
+            return dst;
+        }
+
+        case QImage::Format_RGB888:
+        {
+            QImage dst(img.size(), QImage::Format_RGB32);
+            if (dst.isNull())
+                return {};
+
+            const int width           = img.width();
+            uint8_t *out              = dst.bits();
+            const qsizetype dstStride = dst.bytesPerLine();
+            parallelRows(img.height(), dstStride, [&](int first, int last)
+            {
+                for (int y = first; y < last; ++y)
+                    rgbToRgb32Row(img.constScanLine(y), out + y * dstStride, width);
+            });
+            return dst;
+        }
+
+        default:
+            return img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                             : QImage::Format_RGB32);
+    }
+}
+
+QImage
+halfScale(const QImage &src) noexcept
+{
+    if (src.isNull() || src.depth() != 32)
+        return {};
+
+    const int w = std::max(1, src.width() / 2);
+    const int h = std::max(1, src.height() / 2);
+
+    QImage dst(w, h, src.format());
+    if (dst.isNull())
+        return {};
+
+    // A one pixel wide/high source is averaged with itself
+    const int xstep = src.width() > 1 ? 1 : 0;
+    const int ystep = src.height() > 1 ? 1 : 0;
+
+    for (int y = 0; y < h; ++y)
+    {
+        const uint8_t *r0 = src.constScanLine(y * 2 * ystep);
+        const uint8_t *r1 = src.constScanLine(y * 2 * ystep + ystep);
+        uint8_t *out      = dst.scanLine(y);
+
+        if (xstep)
+            halfScaleRow(r0, r1, out, w);
+        else
+        {
+            for (int c = 0; c < 4; ++c)
+                out[c] = static_cast<uint8_t>((r0[c] + r1[c] + 1) >> 1);
+        }
+    }
+
+    return dst;
+}
+
+QVector<QImage>
+buildMipChain(const QImage &src, int minSize) noexcept
+{
+    QVector<QImage> levels;
+    if (src.isNull())
+        return levels;
+
+    QImage level = src.depth() == 32 ? src : src.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    while (std::min(level.width(), level.height()) / 2 >= minSize)
+    {
+        level = halfScale(level);
+        if (level.isNull())
+            break;
+        levels.append(level);
+    }
+
+    return levels;
+}
+
+bool
+orientationFromTransform(const QTransform &t, Orientation &o) noexcept
+{
+    auto unit = [](qreal v) -> int
+    {
+        if (qFuzzyIsNull(v))
+            return 0;
+        if (qFuzzyCompare(v, 1.0))
+            return 1;
+        if (qFuzzyCompare(v, -1.0))
+            return -1;
+        return 2;
+    };
+
+    const int m11 = unit(t.m11()), m12 = unit(t.m12()), m21 = unit(t.m21()), m22 = unit(t.m22());
+    if (!t.isAffine() || m11 == 2 || m12 == 2 || m21 == 2 || m22 == 2)
+        return false;
+
+    if (m12 == 0 && m21 == 0 && m11 != 0 && m22 != 0)
+    {
+        if (m11 > 0)
+            o = m22 > 0 ? Orientation::Identity : Orientation::FlipVertical;
+        else
+            o = m22 > 0 ? Orientation::FlipHorizontal : Orientation::Rotate180;
+        return true;
+    }
+
+    if (m11 == 0 && m22 == 0 && m12 != 0 && m21 != 0)
+    {
+        if (m12 > 0)
+            o = m21 > 0 ? Orientation::Transpose : Orientation::Rotate90;
+        else
+            o = m21 > 0 ? Orientation::Rotate270 : Orientation::Transverse;
+        return true;
+    }
+
+    return false;
+}
+
+QImage
+orient(const QImage &src, Orientation o) noexcept
+{
+    if (src.isNull())
+        return {};
+
+    if (o == Orientation::Identity)
+        return src;
+
+    const QImage img = src.depth() == 32 ? src : normalize(src);
+    if (img.isNull())
+        return {};
+
+    const bool swapsAxes = o == Orientation::Transpose || o == Orientation::Rotate90 ||
+                           o == Orientation::Transverse || o == Orientation::Rotate270;
+
+    QImage dst(swapsAxes ? img.height() : img.width(), swapsAxes ? img.width() : img.height(), img.format());
+    if (dst.isNull())
+        return {};
+
+    dst.setDevicePixelRatio(img.devicePixelRatio());
+    dst.setDotsPerMeterX(swapsAxes ? img.dotsPerMeterY() : img.dotsPerMeterX());
+    dst.setDotsPerMeterY(swapsAxes ? img.dotsPerMeterX() : img.dotsPerMeterY());
+
+    const OrientMapping m     = orientMapping(o, img.width(), img.height(), dst.bytesPerLine());
+    uint8_t *out              = dst.bits();
+    const int width           = img.width();
+    const qsizetype srcStride = img.bytesPerLine();
+
+    parallelRows(img.height(), srcStride, [&](int first, int last)
+    {
+        if (swapsAxes)
+        {
+            orientTransposeRows(img, out, m, first, last);
+            return;
+        }
+
+        for (int y = first; y < last; ++y)
+        {
+            const uint32_t *row = reinterpret_cast<const uint32_t *>(img.constScanLine(y));
+            orientRow(row, out + m.base + y * m.stepY, width, m.stepX);
+        }
+    });
+
+    return dst;
+}
+
+} // namespace PixelOps
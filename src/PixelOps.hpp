@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QImage>
+#include <QTransform>
+#include <QVector>
+
+// Hot pixel loops shared by the viewer, the decoders and the tools. Every
+// kernel has a scalar implementation and, on x86, vectorized variants picked
+// at runtime.
+namespace PixelOps
+{
+
+// Convert a decoder's output to the raster engine's native format:
+// Format_ARGB32_Premultiplied, or Format_RGB32 when every pixel is opaque.
+// Common decoder formats (RGB888, RGBA8888, ARGB32) take vectorized paths,
+// anything else goes through QImage::convertToFormat. Meant to run on the
+// decode worker so that QPixmap::fromImage() on the GUI thread is a copy.
+QImage normalize(QImage img) noexcept;
+
+// In-place premultiplication of a Format_ARGB32 image. Returns true when all
+// pixels turned out to be opaque.
+bool premultiply(QImage &img) noexcept;
+
+// 2x2 box-filtered half resolution copy of a 32-bit image (ARGB32,
+// ARGB32_Premultiplied or RGB32). Odd trailing rows/columns are dropped.
+QImage halfScale(const QImage &src) noexcept;
+
+// The eight orientations reachable by 90 degree rotations and mirroring.
+// Rotations are clockwise; Transpose mirrors along the main diagonal and
+// Transverse along the anti-diagonal.
+enum class Orientation
+{
+    Identity,
+    FlipHorizontal,
+    FlipVertical,
+    Rotate180,
+    Transpose,
+    Rotate90,
+    Transverse,
+    Rotate270,
+};
+
+// Orientation matching the linear part of `t`. Returns false when `t` is not a
+// pure 90 degree rotation/mirroring (scaling, shearing, arbitrary angles).
+bool orientationFromTransform(const QTransform &t, Orientation &o) noexcept;
+
+// Copy of `src` in orientation `o`. Works in tiles across the global thread
+// pool; 32-bit images keep their format, others are normalized first.
+QImage orient(const QImage &src, Orientation o) noexcept;
+
+// Successive half resolution levels of `src`, largest first, stopping once a
+// level would be smaller than `minSize` on its shorter side. `src` itself is
+// not part of the chain.
+QVector<QImage> buildMipChain(const QImage &src, int minSize = 64) noexcept;
+
+} // namespace PixelOps
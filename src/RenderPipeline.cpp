@@ -0,0 +1,264 @@
+#include "RenderPipeline.hpp"
+
+#include "ImageDecoder.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTransform>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+namespace
+{
+
+struct Job
+{
+    QString input;
+    QString mimeType;
+    QString output;
+};
+
+// Parse the transform options shared by all inputs. Returns false with
+// `error` set when an option has a value ImageView could not reproduce.
+bool
+parseViewState(argparse::ArgumentParser &parser, RenderPipeline::ViewState &state, QString &error) noexcept
+{
+    state.rotation = parser.get<int>("--rotate");
+    if (state.rotation % 90 != 0)
+    {
+        error = QString("--rotate takes a multiple of 90, not %1").arg(state.rotation);
+        return false;
+    }
+
+    const QString flip = QString::fromStdString(parser.get<std::string>("--flip"));
+    if (!QRegularExpression("^[hv]*$").match(flip).hasMatch())
+    {
+        error = QString("--flip takes h, v or hv, not %1").arg(flip);
+        return false;
+    }
+    state.flipHorizontal = flip.contains('h');
+    state.flipVertical   = flip.contains('v');
+
+    const QString size = QString::fromStdString(parser.get<std::string>("--size"));
+    if (!size.isEmpty())
+    {
+        const QRegularExpressionMatch match = QRegularExpression("^(\\d+)x(\\d+)$").match(size);
+        if (!match.hasMatch() || match.captured(1).toInt() <= 0 || match.captured(2).toInt() <= 0)
+        {
+            error = QString("--size takes WIDTHxHEIGHT, not %1").arg(size);
+            return false;
+        }
+        state.viewport = QSize(match.captured(1).toInt(), match.captured(2).toInt());
+    }
+
+    const QString fit = QString::fromStdString(parser.get<std::string>("--fit"));
+    if (!fit.isEmpty())
+    {
+        if (fit == "window")
+            state.fitMode = RenderPipeline::FitMode::WINDOW;
+        else if (fit == "width")
+            state.fitMode = RenderPipeline::FitMode::WIDTH;
+        else if (fit == "height")
+            state.fitMode = RenderPipeline::FitMode::HEIGHT;
+        else
+        {
+            error = QString("--fit takes window, width or height, not %1").arg(fit);
+            return false;
+        }
+        if (state.viewport.isEmpty())
+        {
+            error = "--fit needs the window size, see --size";
+            return false;
+        }
+        state.fit = true;
+    }
+
+    state.zoom = parser.get<double>("--zoom");
+    if (state.zoom <= 0)
+    {
+        error = "--zoom takes a positive factor";
+        return false;
+    }
+    return true;
+}
+
+// Where each input goes: `output` itself for a single input, a file named
+// after the input inside the directory `output` otherwise
+bool
+planJobs(const QStringList &inputs, const QString &output, const QString &format, QVector<Job> &jobs,
+         QString &error) noexcept
+{
+    const bool toDirectory = inputs.size() > 1 || QFileInfo(output).isDir();
+    if (toDirectory && !QDir().mkpath(output))
+    {
+        error = QString("cannot create the output directory %1").arg(output);
+        return false;
+    }
+
+    QMimeDatabase mimeDb;
+    QSet<QString> outputs;
+    for (const QString &input : inputs)
+    {
+        const QString target =
+            toDirectory ? QDir(output).filePath(QFileInfo(input).completeBaseName() + "." + format) : output;
+        if (outputs.contains(target))
+        {
+            error = QString("more than one input would be written to %1").arg(target);
+            return false;
+        }
+        outputs.insert(target);
+        jobs.append({input, mimeDb.mimeTypeForFile(input).name(), target});
+    }
+    return true;
+}
+
+// Decode, render and save one input. Returns an error message, empty on success.
+QString
+renderJob(const Job &job, const RenderPipeline::ViewState &state) noexcept
+{
+    QImage image;
+    const DecodeResult result = ImageDecoder::decode(job.input, job.mimeType);
+    if (result.animated)
+    {
+        // The first frame, as shown before playback starts
+        QVector<int> delays;
+        const QVector<QImage> frames = ImageDecoder::decodeFrames(job.input, delays);
+        if (!frames.isEmpty())
+            image = frames.first();
+    }
+    else
+        image = result.image;
+
+    if (image.isNull())
+        return result.errorMessage.isEmpty() ? QString("cannot decode %1").arg(job.input)
+                                             : QString("%1: %2").arg(job.input, result.errorMessage);
+
+    const QImage rendered = RenderPipeline::render(image, state);
+    if (rendered.isNull())
+        return QString("%1: nothing visible with these options").arg(job.input);
+
+    if (!rendered.save(job.output))
+        return QString("cannot write %1").arg(job.output);
+    return {};
+}
+
+} // namespace
+
+namespace RenderPipeline
+{
+
+QImage
+cropOrientScale(const QImage &source, const QRect &srcRect, PixelOps::Orientation o, qreal scale) noexcept
+{
+    if (srcRect.isEmpty())
+        return {};
+
+    const QImage crop = PixelOps::orient(srcRect == source.rect() ? source : source.copy(srcRect), o);
+    if (qFuzzyCompare(scale, 1.0))
+        return crop;
+
+    const QSize targetSize = (QSizeF(crop.size()) * scale).toSize();
+    if (targetSize.isEmpty())
+        return {};
+
+    return crop.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage
+render(const QImage &source, const ViewState &state) noexcept
+{
+    if (source.isNull())
+        return {};
+
+    // The item transform ImageView builds: setRotation, then the flips
+    QTransform t;
+    t.rotate(state.rotation);
+    if (state.flipHorizontal)
+        t.scale(-1, 1);
+    if (state.flipVertical)
+        t.scale(1, -1);
+
+    PixelOps::Orientation orientation;
+    if (!PixelOps::orientationFromTransform(t, orientation))
+        return {};
+
+    const QRectF oriented = t.mapRect(QRectF(source.rect()));
+    const qreal width     = oriented.width();
+    const qreal height    = oriented.height();
+
+    qreal scale = state.zoom;
+    if (state.fit && !state.viewport.isEmpty())
+    {
+        switch (state.fitMode)
+        {
+            case FitMode::WINDOW:
+                scale = std::min(state.viewport.width() / width, state.viewport.height() / height);
+                break;
+            case FitMode::WIDTH:
+                scale = state.viewport.width() / width;
+                break;
+            case FitMode::HEIGHT:
+                scale = state.viewport.height() / height;
+                break;
+        }
+    }
+
+    // Visible part in oriented image coordinates, then back in source pixels
+    QRectF visible(0, 0, width, height);
+    if (!state.viewport.isEmpty())
+    {
+        const QSizeF visibleSize = QSizeF(state.viewport) / scale;
+        visible = QRectF(QPointF(width - visibleSize.width(), height - visibleSize.height()) / 2, visibleSize)
+                      .intersected(visible);
+    }
+
+    const QRect srcRect =
+        t.inverted().mapRect(visible.translated(oriented.topLeft())).toAlignedRect().intersected(source.rect());
+    return cropOrientScale(source, srcRect, orientation, scale);
+}
+
+int
+run(argparse::ArgumentParser &parser) noexcept
+{
+    QStringList inputs;
+    for (const std::string &input : parser.get<std::vector<std::string>>("--render"))
+        inputs.append(QString::fromStdString(input));
+
+    const QString output = QString::fromStdString(parser.get<std::string>("--output"));
+    if (inputs.isEmpty() || output.isEmpty())
+    {
+        qWarning() << "iv: --render needs input files and an output, see -o";
+        return 1;
+    }
+
+    QString error;
+    ViewState state;
+    QVector<Job> jobs;
+    if (!parseViewState(parser, state, error) ||
+        !planJobs(inputs, output, QString::fromStdString(parser.get<std::string>("--format")), jobs, error))
+    {
+        qWarning().noquote() << "iv:" << error;
+        return 1;
+    }
+
+    // One job per input across the pool; a single large input still uses
+    // every core through the tiled kernels
+    const QStringList errors =
+        QtConcurrent::blockingMapped<QStringList>(jobs, [&state](const Job &job) { return renderJob(job, state); });
+
+    int failures = 0;
+    for (const QString &message : errors)
+    {
+        if (message.isEmpty())
+            continue;
+        qWarning().noquote() << "iv:" << message;
+        ++failures;
+    }
+    return failures == 0 ? 0 : 2;
+}
+
+} // namespace RenderPipeline
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ImageDocument.hpp"
+#include "PixelOps.hpp"
+#include "argparse.hpp"
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+
+// ImageView's rotate/flip/fit/zoom/viewport logic as a function of the decoded
+// image, so that `iv --render` produces what the window would show without
+// creating one.
+namespace RenderPipeline
+{
+
+using FitMode = ImageDocument::FitMode;
+
+// What ImageView would have been told to do with an image
+struct ViewState
+{
+    int rotation{0}; // degrees clockwise, a multiple of 90 (setRotation)
+    bool flipHorizontal{false}; // flipLeftRight, applied after the rotation
+    bool flipVertical{false};   // flipUpDown
+    bool fit{false};            // fitWindow/fitWidth/fitHeight into viewport
+    FitMode fitMode{FitMode::WINDOW};
+    qreal zoom{1.0}; // output pixels per image pixel when not fitting
+    QSize viewport;  // window size in pixels, empty for the whole image
+};
+
+// The part `srcRect` of `source` in orientation `o`, resampled by `scale`.
+// Cropping first keeps the pixel moves and the resampling to what is visible.
+QImage cropOrientScale(const QImage &source, const QRect &srcRect, PixelOps::Orientation o, qreal scale) noexcept;
+
+// The image as ImageView would show it for `state`: the visible region only,
+// centered in the viewport like GraphicsView keeps it
+QImage render(const QImage &source, const ViewState &state) noexcept;
+
+// `iv --render IN... -o OUT`: decode, render and save every input, in
+// parallel across the global thread pool. Returns the process exit code.
+int run(argparse::ArgumentParser &parser) noexcept;
+
+} // namespace RenderPipeline
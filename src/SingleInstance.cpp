@@ -0,0 +1,132 @@
+#include "SingleInstance.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+// A hand-off is a single line of JSON, {"request": "open", "files": [...]},
+// answered by "ok\n". A missing request means "open".
+
+// Connecting to a live server is immediate; these only bound a hung one
+constexpr int CONNECT_TIMEOUT_MS = 200;
+constexpr int ACK_TIMEOUT_MS     = 2000;
+
+SingleInstance::SingleInstance(QObject *parent) noexcept : QObject(parent)
+{
+}
+
+QString
+SingleInstance::socketPath(const QString &name) noexcept
+{
+    const QString runtime = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (!runtime.isEmpty())
+        return QDir(runtime).filePath(name + ".sock");
+    return QString("%1-%2").arg(name, QString::fromLocal8Bit(qgetenv("USER")));
+}
+
+QString
+SingleInstance::serverName() noexcept
+{
+    return socketPath("iv");
+}
+
+bool
+SingleInstance::listenExclusive(QLocalServer *server, const QString &name) noexcept
+{
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    bool listening = server->listen(name);
+
+    if (!listening && server->serverError() == QAbstractSocket::AddressInUseError)
+    {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(CONNECT_TIMEOUT_MS))
+            return false; // another process is serving
+
+        QLocalServer::removeServer(name);
+        listening = server->listen(name);
+    }
+
+    if (!listening)
+        qWarning() << "Cannot listen on" << name << ":" << server->errorString();
+    return listening;
+}
+
+bool
+SingleInstance::listen() noexcept
+{
+    m_server = new QLocalServer(this);
+    if (!listenExclusive(m_server, serverName()))
+        return false;
+
+    connect(m_server, &QLocalServer::newConnection, this, [this]()
+    {
+        while (QLocalSocket *socket = m_server->nextPendingConnection())
+        {
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequest(socket); });
+            readRequest(socket);
+        }
+    });
+    return true;
+}
+
+void
+SingleInstance::readRequest(QLocalSocket *socket) noexcept
+{
+    if (!socket->canReadLine())
+        return;
+
+    const QJsonDocument doc = QJsonDocument::fromJson(socket->readLine());
+    if (!doc.isObject())
+    {
+        socket->disconnectFromServer();
+        return;
+    }
+
+    QStringList files;
+    for (const QJsonValue &value : doc.object().value("files").toArray())
+        files.append(value.toString());
+
+    socket->write("ok\n");
+    socket->flush();
+    socket->disconnectFromServer();
+
+    if (doc.object().value("request").toString() == "preload")
+        emit preloadRequested(files);
+    else
+        emit filesRequested(files);
+}
+
+bool
+SingleInstance::handOff(const QStringList &files, Request request) noexcept
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS))
+        return false;
+
+    // Relative paths mean nothing to a process with another working directory
+    QJsonArray paths;
+    for (const QString &file : files)
+        paths.append(QFileInfo(file).absoluteFilePath());
+
+    const QJsonObject message{
+        {"request", request == Request::Preload ? "preload" : "open"},
+        {"files", paths},
+    };
+    socket.write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    if (!socket.waitForBytesWritten(ACK_TIMEOUT_MS))
+        return false;
+
+    while (!socket.canReadLine())
+    {
+        if (!socket.waitForReadyRead(ACK_TIMEOUT_MS))
+            return false;
+    }
+    return socket.readLine().trimmed() == "ok";
+}
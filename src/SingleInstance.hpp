@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QStringList>
+
+// Hand-off of files from a newly started iv to one that is already running,
+// over a per-user local socket. Only an instance started with
+// behavior.single_instance, --single-instance or --daemon listens, so a
+// successful connection means the running instance opted in.
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SingleInstance(QObject *parent = nullptr) noexcept;
+
+    // Start accepting hand-offs. Fails when another instance already listens.
+    bool listen() noexcept;
+
+    // What the running instance should do with the files
+    enum class Request
+    {
+        Open,    // show them in its window
+        Preload, // only decode them into its cache
+    };
+
+    // Client side: pass `files` to the running instance. Returns false when
+    // there is none or it did not acknowledge, in which case the caller
+    // opens the files itself.
+    static bool handOff(const QStringList &files, Request request = Request::Open) noexcept;
+
+    static QString serverName() noexcept;
+
+    // Per-user socket `name`: a path in the runtime directory when there is
+    // one, so that different users never talk to each other's instance
+    static QString socketPath(const QString &name) noexcept;
+
+    // Listen on `name`, taking over a socket file left behind by a crashed
+    // process but not one that is still being served
+    static bool listenExclusive(QLocalServer *server, const QString &name) noexcept;
+
+signals:
+    // Absolute paths; empty when the new process was started without files
+    void filesRequested(const QStringList &files);
+    void preloadRequested(const QStringList &files);
+
+private:
+    void readRequest(QLocalSocket *socket) noexcept;
+
+    QLocalServer *m_server{nullptr};
+};
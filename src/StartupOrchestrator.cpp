@@ -0,0 +1,121 @@
+#include "StartupOrchestrator.hpp"
+
+#include "DecodeScheduler.hpp"
+#include "MainWindow.hpp"
+#include "Trace.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <fcntl.h>
+
+ParsedConfig
+ParsedConfig::parse(const QString &path) noexcept
+{
+    IV_TRACE_SCOPE("ParsedConfig::parse");
+
+    ParsedConfig parsed;
+    try
+    {
+        parsed.table = toml::parse_file(path.toStdString());
+    }
+    catch (const toml::parse_error &e)
+    {
+        parsed.error = e.what();
+    }
+    return parsed;
+}
+
+void
+StartupOrchestrator::start(argparse::ArgumentParser &parser) noexcept
+{
+    // These print and exit before anything is loaded
+    if (parser.is_used("version") || parser.is_used("commands"))
+        return;
+
+    QString firstSuffix;
+    if (parser.is_used("files") && !parser.is_used("not-tabbed"))
+    {
+        const auto files = parser.get<std::vector<std::string>>("files");
+        if (!files.empty())
+        {
+            m_first_file = QString::fromStdString(files.front());
+            firstSuffix  = QFileInfo(m_first_file).suffix().toUpper();
+        }
+    }
+
+    // Same lookup as MainWindow::readArgs()
+    m_config_path = CONFIG_DIR + "config.toml";
+    if (parser.is_used("config"))
+        m_config_path = QString::fromStdString(parser.get<std::string>("config"));
+
+    // All of it is in the way of the first image, so it runs in the visible
+    // class. Loading the coder of the first file is part of the first decode,
+    // so it is done here as well.
+    m_magick = DecodeScheduler::instance().run(DecodeScheduler::Priority::Visible, [firstSuffix]()
+    {
+        ImageDecoder::initialize();
+        if (firstSuffix.isEmpty())
+            return;
+
+        IV_TRACE_SCOPE("Magick::CoderInfo");
+        try
+        {
+            Magick::CoderInfo info(firstSuffix.toStdString());
+        }
+        catch (...)
+        {
+            // Unknown to ImageMagick, the decode will report it
+        }
+    });
+
+    const QString configPath = m_config_path;
+    m_config         = DecodeScheduler::instance().run(DecodeScheduler::Priority::Visible,
+                                                       [configPath]() { return ParsedConfig::parse(configPath); });
+    m_config_pending = true;
+
+    if (m_first_file.isEmpty())
+        return;
+
+    // Have the kernel read the file while ImageMagick initializes, decode()
+    // then joins the initialization and reads from the page cache
+    const QString file = m_first_file;
+    m_first_decode     = DecodeScheduler::instance().run(DecodeScheduler::Priority::Visible, [file]()
+    {
+        IV_TRACE_SCOPE_DETAIL("StartupOrchestrator::firstDecode", file);
+
+        const QString mimeType = QMimeDatabase().mimeTypeForFile(file).name();
+
+        QFile f(file);
+        if (f.open(QIODevice::ReadOnly))
+        {
+            IV_TRACE_SCOPE("read ahead");
+            posix_fadvise(f.handle(), 0, 0, POSIX_FADV_WILLNEED);
+        }
+
+        return ImageDecoder::decode(file, mimeType);
+    });
+}
+
+ParsedConfig
+StartupOrchestrator::config(const QString &path) noexcept
+{
+    if (m_config_pending && path == m_config_path)
+    {
+        m_config_pending = false;
+        return m_config.result();
+    }
+
+    return ParsedConfig::parse(path);
+}
+
+bool
+StartupOrchestrator::takeDecode(const QString &filepath, QFuture<DecodeResult> &future) noexcept
+{
+    if (m_first_file.isEmpty() || filepath != m_first_file)
+        return false;
+
+    m_first_file.clear();
+    future = m_first_decode;
+    return true;
+}
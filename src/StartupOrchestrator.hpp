@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ImageDecoder.hpp"
+#include "argparse.hpp"
+#include "toml.hpp"
+
+#include <QFuture>
+#include <QString>
+
+// Contents of the config file, or why it could not be read
+struct ParsedConfig
+{
+    toml::table table;
+    QString error;
+
+    static ParsedConfig parse(const QString &path) noexcept;
+};
+
+// Startup work that needs neither the GUI thread nor each other: ImageMagick
+// initialization, parsing the config file, and reading, probing and decoding
+// the first file given on the command line. start() puts all of it in the
+// visible class of the DecodeScheduler right after argument parsing; the
+// window joins each result only where it is first needed.
+class StartupOrchestrator
+{
+public:
+    void start(argparse::ArgumentParser &parser) noexcept;
+
+    // The parsed config file at `path`. Joins the parse started by start() if
+    // it was for the same file, parses on the calling thread otherwise.
+    ParsedConfig config(const QString &path) noexcept;
+
+    // Hand out the decode of `filepath` if start() began it, at most once
+    bool takeDecode(const QString &filepath, QFuture<DecodeResult> &future) noexcept;
+
+private:
+    // Never joined: decodes wait for it through ImageDecoder::initialize()
+    QFuture<void> m_magick;
+
+    QString m_config_path;
+    QFuture<ParsedConfig> m_config;
+    bool m_config_pending{false};
+
+    QString m_first_file;
+    QFuture<DecodeResult> m_first_decode;
+};
@@ -0,0 +1,140 @@
+#include "StartupProfiler.hpp"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QTextStream>
+#include <QTimer>
+#include <QWidget>
+#include <QWindow>
+
+// Give up when nothing is shown within this time, e.g. a huge file
+constexpr int TIMEOUT_MS = 60 * 1000;
+
+StartupProfiler::StartupProfiler() noexcept
+{
+    m_clock.start();
+    m_phases.reserve(32);
+}
+
+StartupProfiler *
+StartupProfiler::instance() noexcept
+{
+    // Created by the first mark() at the top of main()
+    static StartupProfiler profiler;
+    return &profiler;
+}
+
+void
+StartupProfiler::mark(const char *phase) noexcept
+{
+    StartupProfiler *p = instance();
+    if (!p->m_finished)
+        p->m_phases.append({phase, p->m_clock.nsecsElapsed()});
+}
+
+void
+StartupProfiler::enable() noexcept
+{
+    StartupProfiler *p = instance();
+    p->m_enabled       = true;
+    QTimer::singleShot(TIMEOUT_MS, p, []() { finish("timed out"); });
+}
+
+bool
+StartupProfiler::enabled() noexcept
+{
+    return instance()->m_enabled;
+}
+
+void
+StartupProfiler::watchWindow(QWindow *window, bool expectImage) noexcept
+{
+    StartupProfiler *p = instance();
+    if (!p->m_enabled || !window)
+        return;
+
+    p->m_window       = window;
+    p->m_expect_image = expectImage;
+    window->installEventFilter(p);
+}
+
+void
+StartupProfiler::watchFirstPixel(QWidget *viewport) noexcept
+{
+    StartupProfiler *p = instance();
+    if (!p->m_enabled || !viewport || p->m_first_pixel_ns >= 0 || p->m_viewport)
+        return;
+
+    p->m_viewport = viewport;
+    viewport->installEventFilter(p);
+    viewport->update();
+}
+
+bool
+StartupProfiler::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == m_window && event->type() == QEvent::Expose && m_window->isExposed())
+    {
+        m_window->removeEventFilter(this);
+        m_window    = nullptr;
+        m_window_ns = m_clock.nsecsElapsed();
+        mark("window_exposed");
+        if (!m_expect_image)
+            QMetaObject::invokeMethod(this, []() { finish(); }, Qt::QueuedConnection);
+    }
+    else if (object == m_viewport && event->type() == QEvent::Paint)
+    {
+        m_viewport->removeEventFilter(this);
+        m_viewport = nullptr;
+
+        // Queued so that it runs once the paint (and the flush that follows
+        // it) is done
+        QMetaObject::invokeMethod(this, [this]()
+        {
+            m_first_pixel_ns = m_clock.nsecsElapsed();
+            mark("first_pixel");
+            finish();
+        }, Qt::QueuedConnection);
+    }
+
+    return QObject::eventFilter(object, event);
+}
+
+void
+StartupProfiler::finish(const char *reason) noexcept
+{
+    StartupProfiler *p = instance();
+    if (!p->m_enabled || p->m_finished)
+        return;
+
+    p->m_finished = true;
+    p->report(reason);
+    QCoreApplication::exit(reason ? 1 : 0);
+}
+
+void
+StartupProfiler::report(const char *reason) const noexcept
+{
+    QTextStream out(stdout);
+    auto ms = [](qint64 ns) { return QString::number(ns / 1e6, 'f', 2); };
+
+    out << "Startup timeline (ms since main)\n";
+    out << QString("  %1 %2 %3\n").arg(QString("phase"), -24).arg(QString("at"), 10).arg(QString("took"), 10);
+
+    qint64 previous = 0;
+    for (const Phase &phase : m_phases)
+    {
+        out << QString("  %1 %2 %3\n")
+                   .arg(QString::fromLatin1(phase.name), -24)
+                   .arg(ms(phase.ns), 10)
+                   .arg(ms(phase.ns - previous), 10);
+        previous = phase.ns;
+    }
+
+    out << "\n";
+    out << "time_to_window      " << (m_window_ns >= 0 ? ms(m_window_ns) + " ms" : QString("n/a")) << "\n";
+    out << "time_to_first_pixel " << (m_first_pixel_ns >= 0 ? ms(m_first_pixel_ns) + " ms" : QString("n/a")) << "\n";
+
+    if (reason)
+        out << "incomplete: " << reason << "\n";
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+class QWindow;
+class QWidget;
+
+// Startup phase timeline behind --measure-startup. Phases are marked on the
+// GUI thread as they end; marking is always on (a handful of entries per run)
+// and only reported once enabled. The report covers time-to-window (first
+// expose of the main window) and time-to-first-pixel (first paint after the
+// first image was loaded), then quits the application.
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    // Record the end of startup phase `phase`, a string literal
+    static void mark(const char *phase) noexcept;
+
+    static void enable() noexcept;
+    static bool enabled() noexcept;
+
+    // Report time-to-window on the first expose of `window`; without files to
+    // open this also finishes the measurement
+    static void watchWindow(QWindow *window, bool expectImage) noexcept;
+
+    // Report time-to-first-pixel on the next paint of `viewport`
+    static void watchFirstPixel(QWidget *viewport) noexcept;
+
+    // Print what was measured so far and quit, e.g. when the file failed to open
+    static void finish(const char *reason = nullptr) noexcept;
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event) override;
+
+private:
+    StartupProfiler() noexcept;
+    static StartupProfiler *instance() noexcept;
+    void report(const char *reason) const noexcept;
+
+    struct Phase
+    {
+        const char *name;
+        qint64 ns;
+    };
+
+    QElapsedTimer m_clock;
+    QVector<Phase> m_phases;
+    QWindow *m_window{nullptr};
+    QWidget *m_viewport{nullptr};
+    qint64 m_window_ns{-1}, m_first_pixel_ns{-1};
+    bool m_enabled{false}, m_expect_image{false}, m_finished{false};
+};
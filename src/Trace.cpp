@@ -0,0 +1,147 @@
+#include "Trace.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QThread>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace Trace
+{
+
+std::atomic<bool> detail::enabled{false};
+
+namespace
+{
+
+struct Event
+{
+    const char *name;
+    qint64 begin;
+    qint64 duration;
+    int tid;
+    QString detail;
+};
+
+std::mutex s_mutex;
+std::vector<Event> s_events;
+QMap<int, QString> s_thread_names;
+QString s_path;
+std::chrono::steady_clock::time_point s_origin;
+std::atomic<int> s_next_tid{1};
+thread_local int t_tid{0};
+
+// Small sequential ids read better in the viewer than native thread handles;
+// the first thread seen is the one that called start(), i.e. the GUI thread
+int
+threadId() noexcept
+{
+    if (t_tid)
+        return t_tid;
+
+    t_tid = s_next_tid.fetch_add(1);
+
+    QString name = QThread::currentThread()->objectName();
+    if (name.isEmpty())
+        name = t_tid == 1 ? QString("GUI") : QString("Worker %1").arg(t_tid - 1);
+
+    std::lock_guard lock(s_mutex);
+    s_thread_names.insert(t_tid, name);
+    return t_tid;
+}
+
+} // namespace
+
+void
+start(const QString &path) noexcept
+{
+    {
+        std::lock_guard lock(s_mutex);
+        s_path   = path;
+        s_origin = std::chrono::steady_clock::now();
+        s_events.clear();
+        s_events.reserve(4096);
+    }
+
+    threadId();
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+qint64
+now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_origin).count();
+}
+
+void
+complete(const char *name, qint64 begin, qint64 end, const QString &detail) noexcept
+{
+    const int tid = threadId();
+
+    std::lock_guard lock(s_mutex);
+    if (!enabled())
+        return;
+    s_events.push_back({name, begin, end - begin, tid, detail});
+}
+
+bool
+stop() noexcept
+{
+    if (!enabled())
+        return true;
+
+    detail::enabled.store(false, std::memory_order_relaxed);
+
+    std::lock_guard lock(s_mutex);
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    for (auto it = s_thread_names.cbegin(); it != s_thread_names.cend(); ++it)
+    {
+        events.append(QJsonObject{
+            {"name", "thread_name"},
+            {"ph", "M"},
+            {"pid", pid},
+            {"tid", it.key()},
+            {"args", QJsonObject{{"name", it.value()}}},
+        });
+    }
+
+    for (const Event &e : s_events)
+    {
+        QJsonObject event{
+            {"name", e.name},
+            {"cat", "iv"},
+            {"ph", "X"},
+            {"ts", e.begin},
+            {"dur", e.duration},
+            {"pid", pid},
+            {"tid", e.tid},
+        };
+        if (!e.detail.isEmpty())
+            event["args"] = QJsonObject{{"detail", e.detail}};
+        events.append(event);
+    }
+
+    s_events.clear();
+    s_events.shrink_to_fit();
+
+    QFile file(s_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Trace: cannot write" << s_path;
+        return false;
+    }
+
+    const QJsonObject root{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+} // namespace Trace
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+
+// Timeline tracing of the load and render pipeline in the Chrome trace-event
+// format (loadable in Perfetto or about:tracing). Recording is off unless
+// start() was called; a disabled scope costs one relaxed atomic load.
+namespace Trace
+{
+
+namespace detail
+{
+extern std::atomic<bool> enabled;
+}
+
+inline bool
+enabled() noexcept
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Start recording; the events are written to `path` by stop()
+void start(const QString &path) noexcept;
+
+// Stop recording and write the trace file. Returns false if it could not be
+// written.
+bool stop() noexcept;
+
+// Microseconds since start()
+qint64 now() noexcept;
+
+// Record a complete ("X") event on the calling thread. `name` must outlive the
+// trace, i.e. be a string literal.
+void complete(const char *name, qint64 begin, qint64 end, const QString &detail = QString()) noexcept;
+
+// Times the enclosing scope; use through IV_TRACE_SCOPE
+class Scope
+{
+public:
+    explicit Scope(const char *name) noexcept : m_name(enabled() ? name : nullptr)
+    {
+        if (m_name)
+            m_begin = now();
+    }
+
+    ~Scope()
+    {
+        if (m_name)
+            complete(m_name, m_begin, now(), m_detail);
+    }
+
+    Scope(const Scope &)            = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    inline bool active() const noexcept
+    {
+        return m_name != nullptr;
+    }
+
+    // Shown as the event's argument, e.g. the file being decoded
+    inline void setDetail(const QString &detail) noexcept
+    {
+        m_detail = detail;
+    }
+
+private:
+    const char *m_name{nullptr};
+    qint64 m_begin{0};
+    QString m_detail;
+};
+
+} // namespace Trace
+
+#define IV_TRACE_CONCAT_(a, b) a##b
+#define IV_TRACE_CONCAT(a, b)  IV_TRACE_CONCAT_(a, b)
+
+// Record the enclosing scope as `name`
+#define IV_TRACE_SCOPE(name) Trace::Scope IV_TRACE_CONCAT(iv_trace_scope_, __LINE__)(name)
+
+// Same, with `detail` as argument; `detail` is only evaluated while tracing
+#define IV_TRACE_SCOPE_DETAIL(name, detail)                                                                           \
+    IV_TRACE_SCOPE(name);                                                                                              \
+    if (IV_TRACE_CONCAT(iv_trace_scope_, __LINE__).active())                                                           \
+    IV_TRACE_CONCAT(iv_trace_scope_, __LINE__).setDetail(detail)
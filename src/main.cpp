@@ -1,12 +1,103 @@
+#include "CommandServer.hpp"
+#include "DecoderPool.hpp"
+#include "DecoderSelector.hpp"
 #include "MainWindow.hpp"
+#include "RenderPipeline.hpp"
+#include "SingleInstance.hpp"
+#include "StartupOrchestrator.hpp"
+#include "StartupProfiler.hpp"
+#include "Trace.hpp"
 #include "argparse.hpp"
 
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <cstdlib>
+#include <cstring>
+
+// Scripted control of a running instance (--command). This runs before
+// QApplication, so it works without a display, e.g. over ssh.
+static int
+runCommandClient(int argc, char *argv[]) noexcept
+{
+    QStringList commands;
+    const auto add = [&commands](const QString &value)
+    {
+        if (value == "-")
+        {
+            QTextStream in(stdin);
+            while (!in.atEnd())
+                commands.append(in.readLine());
+        }
+        else
+            commands.append(value.split('\n'));
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--command") == 0 && i + 1 < argc)
+            add(QString::fromLocal8Bit(argv[++i]));
+        else if (std::strncmp(argv[i], "--command=", 10) == 0)
+            add(QString::fromLocal8Bit(argv[i] + 10));
+    }
+
+    // The instance resolves paths in its own working directory, not ours
+    for (QString &command : commands)
+    {
+        const QString line = command.trimmed();
+        if (line.startsWith("open "))
+            command = "open " + QDir::current().absoluteFilePath(line.mid(5).trimmed());
+    }
+
+    QStringList replies;
+    if (!CommandServer::send(commands, replies))
+    {
+        qWarning() << "iv: no running instance accepts commands (behavior.command_server or iv --daemon)";
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    bool ok = true;
+    for (const QString &reply : replies)
+    {
+        out << reply << '\n';
+        ok = ok && QJsonDocument::fromJson(reply.toUtf8()).object().value("ok").toBool();
+    }
+    return ok ? 0 : 2;
+}
+
 int
 main(int argc, char *argv[])
 {
+    // A decoder process started by DecoderPool: no window, no options
+    if (argc >= 2 && std::strcmp(argv[1], "--decode-worker") == 0)
+    {
+        QCoreApplication app(argc, argv);
+        return DecoderPool::runWorker(argc > 2 ? std::atoi(argv[2]) : 0,
+                                      argc > 3 ? QString::fromLocal8Bit(argv[3]) : QString());
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--command") == 0 || std::strncmp(argv[i], "--command=", 10) == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return runCommandClient(argc, argv);
+        }
+    }
+
+    StartupProfiler::mark("start");
+
+    // Rendering needs no display; this has to be decided before QApplication
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--render") == 0 && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QGuiApplication::setHighDpiScaleFactorRoundingPolicy(Qt::HighDpiScaleFactorRoundingPolicy::PassThrough);
     QApplication app(argc, argv);
-    MainWindow mw;
+    StartupProfiler::mark("qapplication");
 
     argparse::ArgumentParser program("iv", __IV_VERSION);
     // program.add_argument("version").flag().help("Show version information");
@@ -30,6 +121,81 @@ main(int argc, char *argv[])
         .flag()
         .help("Open files in separate windows instead of tabs");
 
+    program.add_argument("--trace")
+        .help("Record a Chrome trace-event timeline of loading and rendering to FILE (open it in Perfetto)")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("FILE");
+
+    program.add_argument("--single-instance")
+        .flag()
+        .help("Open the files in an already running iv, or let later invocations open theirs in this one");
+
+    program.add_argument("--daemon")
+        .flag()
+        .help("Keep running without a window, with decoders and caches warm, and serve later invocations");
+
+    program.add_argument("--preload")
+        .flag()
+        .help("Have a running daemon decode the files ahead of time instead of opening them");
+
+    program.add_argument("--command")
+        .append()
+        .help("Run a command in the running iv (behavior.command_server or --daemon) and print its JSON reply; "
+              "repeatable, '-' reads commands from stdin")
+        .metavar("CMD");
+
+    program.add_argument("--render")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .help("Render the files as the window would show them and save the result to -o, without a window")
+        .metavar("FILE");
+
+    program.add_argument("-o", "--output")
+        .help("Output file of --render, or directory when rendering several files")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("OUT");
+
+    program.add_argument("--format")
+        .help("File format of --render outputs written to a directory")
+        .default_value(std::string("png"))
+        .nargs(1)
+        .metavar("EXT");
+
+    program.add_argument("--rotate")
+        .help("--render: rotate clockwise by a multiple of 90 degrees")
+        .default_value(0)
+        .scan<'i', int>()
+        .metavar("DEGREES");
+
+    program.add_argument("--flip")
+        .help("--render: flip horizontally (h), vertically (v) or both (hv), after rotating")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("h|v|hv");
+
+    program.add_argument("--fit")
+        .help("--render: fit the image to the window given by --size")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("window|width|height");
+
+    program.add_argument("--zoom")
+        .help("--render: output pixels per image pixel when not fitting")
+        .default_value(1.0)
+        .scan<'g', double>()
+        .metavar("FACTOR");
+
+    program.add_argument("--size")
+        .help("--render: window size; only the part of the image it shows is rendered")
+        .default_value(std::string())
+        .nargs(1)
+        .metavar("WxH");
+
+    program.add_argument("--measure-startup")
+        .flag()
+        .help("Report time-to-window, time-to-first-pixel and the startup phases, then exit");
+
     program.add_argument("files").help("File path(s) to open").remaining().metavar("FILE_PATH(s)");
 
     try
@@ -41,6 +207,57 @@ main(int argc, char *argv[])
         qDebug() << e.what();
     }
 
-    mw.readArgs(program);
-    app.exec();
+    StartupProfiler::mark("args");
+
+    if (program.is_used("--render"))
+        return RenderPipeline::run(program);
+
+    // A running instance in single instance mode opens the files with its
+    // warm caches. Options that only make sense for a process of its own
+    // keep this one.
+    const bool ownProcess = program.is_used("--not-tabbed") || program.is_used("--config") ||
+                            program.is_used("--trace") || program.is_used("--measure-startup") ||
+                            program.is_used("--version") || program.is_used("--commands") ||
+                            program.is_used("--daemon");
+    if (!ownProcess)
+    {
+        QStringList files;
+        if (program.is_used("files"))
+        {
+            for (const std::string &file : program.get<std::vector<std::string>>("files"))
+                files.append(QString::fromStdString(file));
+        }
+
+        const bool preload = program.is_used("--preload");
+        if (SingleInstance::handOff(files, preload ? SingleInstance::Request::Preload : SingleInstance::Request::Open))
+            return 0;
+
+        if (preload)
+        {
+            qWarning() << "iv: --preload needs a running instance (iv --daemon)";
+            return 1;
+        }
+    }
+
+    const std::string tracePath = program.get<std::string>("--trace");
+    if (!tracePath.empty())
+        Trace::start(QString::fromStdString(tracePath));
+
+    // ImageMagick, the config file and the first file load on workers while
+    // the window is being built
+    StartupOrchestrator startup;
+    startup.start(program);
+    StartupProfiler::mark("workers_started");
+
+    if (program.get<bool>("--measure-startup"))
+        StartupProfiler::enable();
+
+    MainWindow mw;
+    StartupProfiler::mark("main_window");
+    mw.readArgs(program, &startup);
+    const int status = app.exec();
+
+    DecoderSelector::instance().save();
+    Trace::stop();
+    return status;
 }